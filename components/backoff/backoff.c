@@ -0,0 +1,39 @@
+#include "backoff.h"
+
+void datadog_php_backoff_ctor(datadog_php_backoff *backoff, uint64_t base_ns,
+                              uint64_t max_ns, uint64_t seed) {
+  backoff->base_ns = base_ns;
+  backoff->max_ns = max_ns < base_ns ? base_ns : max_ns;
+  backoff->failures = 0;
+  backoff->retry_at = 0;
+  datadog_php_prng_ctor(&backoff->prng, seed);
+}
+
+bool datadog_php_backoff_allows(const datadog_php_backoff *backoff,
+                                uint64_t now) {
+  return now >= backoff->retry_at;
+}
+
+void datadog_php_backoff_succeeded(datadog_php_backoff *backoff) {
+  backoff->failures = 0;
+  backoff->retry_at = 0;
+}
+
+uint64_t datadog_php_backoff_failed(datadog_php_backoff *backoff,
+                                    uint64_t now) {
+  // Double the delay for each failure so far, without overflowing.
+  uint64_t ceiling = backoff->base_ns;
+  for (uint32_t i = 0; i != backoff->failures && ceiling < backoff->max_ns;
+       ++i) {
+    ceiling = ceiling <= backoff->max_ns / 2 ? ceiling * 2 : backoff->max_ns;
+  }
+  if (backoff->failures != UINT32_MAX) {
+    ++backoff->failures;
+  }
+
+  uint64_t half = ceiling / 2;
+  uint64_t delay =
+      ceiling - half + datadog_php_prng_below(&backoff->prng, half + 1);
+  backoff->retry_at = now + delay;
+  return delay;
+}
@@ -0,0 +1,47 @@
+#ifndef DATADOG_PHP_BACKOFF_H
+#define DATADOG_PHP_BACKOFF_H
+
+#include <components/prng/prng.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A circuit breaker with exponential backoff and jitter, for something which
+ * keeps failing, such as uploading to an agent which is down. After each
+ * consecutive failure the breaker opens for a delay which doubles from
+ * `base_ns` up to `max_ns`. The delay is picked at random from its upper
+ * half, so that many processes which failed together don't retry together.
+ * Once the delay has passed, one more attempt is allowed, and a success
+ * closes the breaker again.
+ *
+ * Times are in nanoseconds from a monotonic clock. It isn't thread-safe.
+ */
+typedef struct datadog_php_backoff_s {
+  uint64_t base_ns;
+  uint64_t max_ns;
+  uint32_t failures; // consecutive
+  uint64_t retry_at; // when an attempt is allowed again; 0 when closed
+  datadog_php_prng prng;
+} datadog_php_backoff;
+
+void datadog_php_backoff_ctor(datadog_php_backoff *backoff, uint64_t base_ns,
+                              uint64_t max_ns, uint64_t seed);
+
+/**
+ * Returns whether an attempt should be made at `now`.
+ */
+bool datadog_php_backoff_allows(const datadog_php_backoff *backoff,
+                                uint64_t now);
+
+/**
+ * Closes the breaker and forgets past failures.
+ */
+void datadog_php_backoff_succeeded(datadog_php_backoff *backoff);
+
+/**
+ * Opens the breaker for the next delay, starting at `now`, and returns the
+ * delay.
+ */
+uint64_t datadog_php_backoff_failed(datadog_php_backoff *backoff, uint64_t now);
+
+#endif // DATADOG_PHP_BACKOFF_H
@@ -0,0 +1,65 @@
+extern "C" {
+#include <components/backoff/backoff.h>
+}
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("closed breaker allows attempts", "[backoff]") {
+  datadog_php_backoff backoff;
+  datadog_php_backoff_ctor(&backoff, 1000, 8000, 42);
+
+  CHECK(datadog_php_backoff_allows(&backoff, 0));
+  CHECK(datadog_php_backoff_allows(&backoff, UINT64_MAX));
+}
+
+TEST_CASE("failures open the breaker with growing delays", "[backoff]") {
+  datadog_php_backoff backoff;
+  datadog_php_backoff_ctor(&backoff, 1000, 8000, 42);
+
+  uint64_t now = 100000;
+  uint64_t ceilings[] = {1000, 2000, 4000, 8000, 8000, 8000};
+  for (uint64_t ceiling : ceilings) {
+    uint64_t delay = datadog_php_backoff_failed(&backoff, now);
+    CHECK(delay >= ceiling / 2);
+    CHECK(delay <= ceiling);
+    CHECK(backoff.retry_at == now + delay);
+    CHECK(!datadog_php_backoff_allows(&backoff, now));
+    CHECK(!datadog_php_backoff_allows(&backoff, now + delay - 1));
+    CHECK(datadog_php_backoff_allows(&backoff, now + delay));
+    now += delay;
+  }
+  CHECK(backoff.failures == 6);
+
+  datadog_php_backoff_succeeded(&backoff);
+  CHECK(backoff.failures == 0);
+  CHECK(datadog_php_backoff_allows(&backoff, now));
+
+  // after a success, the delays start over
+  uint64_t delay = datadog_php_backoff_failed(&backoff, now);
+  CHECK(delay >= 500);
+  CHECK(delay <= 1000);
+}
+
+TEST_CASE("delays are jittered", "[backoff]") {
+  datadog_php_backoff a, b;
+  datadog_php_backoff_ctor(&a, 1000000000, 8000000000, 1);
+  datadog_php_backoff_ctor(&b, 1000000000, 8000000000, 2);
+
+  bool differ = false;
+  for (int i = 0; i != 4; ++i) {
+    differ |= datadog_php_backoff_failed(&a, 0) !=
+              datadog_php_backoff_failed(&b, 0);
+  }
+  CHECK(differ);
+}
+
+TEST_CASE("large delays don't overflow", "[backoff]") {
+  datadog_php_backoff backoff;
+  datadog_php_backoff_ctor(&backoff, UINT64_MAX / 4, UINT64_MAX / 2, 7);
+
+  for (int i = 0; i != 70; ++i) {
+    uint64_t delay = datadog_php_backoff_failed(&backoff, 0);
+    CHECK(delay >= UINT64_MAX / 8);
+    CHECK(delay <= UINT64_MAX / 2);
+  }
+}
@@ -3,14 +3,13 @@
 #if DATADOG_HAVE_PTHREAD_GETCPUCLOCKID
 
 #include <errno.h>
-#include <pthread.h>
 #include <string.h>
 
-datadog_php_cpu_time_result datadog_php_cpu_time_now(void) {
+datadog_php_cpu_time_result datadog_php_cpu_time_of(pthread_t thread) {
   struct timespec timespec;
   clockid_t clockid; //  todo: cache this?
 
-  if (pthread_getcpuclockid(pthread_self(), &clockid)) {
+  if (pthread_getcpuclockid(thread, &clockid)) {
     return (datadog_php_cpu_time_result){
         .tag = DATADOG_PHP_CPU_TIME_ERR,
         .err = strerror(errno),
@@ -36,8 +35,8 @@ datadog_php_cpu_time_result datadog_php_cpu_time_now(void) {
 #include <mach/mach_init.h>
 #include <mach/thread_act.h>
 
-datadog_php_cpu_time_result datadog_php_cpu_time_now(void) {
-  mach_port_t thread = mach_thread_self();
+datadog_php_cpu_time_result datadog_php_cpu_time_of(pthread_t pthread) {
+  mach_port_t thread = pthread_mach_thread_np(pthread);
   mach_msg_type_number_t count = THREAD_BASIC_INFO_COUNT;
   thread_basic_info_data_t info;
   kern_return_t kr =
@@ -64,3 +63,7 @@ datadog_php_cpu_time_result datadog_php_cpu_time_now(void) {
 #else
 #error Unhandled platform for cpu time
 #endif
+
+datadog_php_cpu_time_result datadog_php_cpu_time_now(void) {
+  return datadog_php_cpu_time_of(pthread_self());
+}
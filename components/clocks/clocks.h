@@ -1,6 +1,7 @@
 #ifndef DATADOG_PHP_CLOCKS_H
 #define DATADOG_PHP_CLOCKS_H
 
+#include <pthread.h>
 #include <stdint.h>
 #include <time.h>
 
@@ -25,4 +26,10 @@ typedef struct datadog_php_cpu_time_result_s {
 
 datadog_php_cpu_time_result datadog_php_cpu_time_now(void);
 
+/**
+ * Returns the cpu time consumed so far by `thread`, which may be a thread
+ * other than the calling one.
+ */
+datadog_php_cpu_time_result datadog_php_cpu_time_of(pthread_t thread);
+
 #endif // DATADOG_PHP_CLOCKS_H
@@ -0,0 +1,110 @@
+#include "endpoint_totals.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+void datadog_php_endpoint_totals_ctor(datadog_php_endpoint_totals *totals) {
+  datadog_php_endpoint_totals_clear(totals);
+}
+
+void datadog_php_endpoint_totals_clear(datadog_php_endpoint_totals *totals) {
+  totals->len = 0;
+}
+
+bool datadog_php_endpoint_totals_add(datadog_php_endpoint_totals *totals,
+                                     datadog_php_string_view name,
+                                     int64_t count, int64_t wall_time,
+                                     int64_t cpu_time) {
+  if (name.len > DATADOG_PHP_ENDPOINT_TOTALS_NAME_CAPACITY) {
+    name.len = DATADOG_PHP_ENDPOINT_TOTALS_NAME_CAPACITY;
+  }
+
+  datadog_php_endpoint_total *total = NULL;
+  for (uint16_t i = 0; i != totals->len; ++i) {
+    datadog_php_endpoint_total *candidate = &totals->totals[i];
+    if (candidate->name_len == name.len &&
+        memcmp(candidate->name, name.ptr, name.len) == 0) {
+      total = candidate;
+      break;
+    }
+  }
+
+  if (!total) {
+    if (totals->len == DATADOG_PHP_ENDPOINT_TOTALS_CAPACITY) {
+      return false;
+    }
+    total = &totals->totals[totals->len++];
+    total->count = total->wall_time = total->cpu_time = 0;
+    total->name_len = (uint8_t)name.len;
+    memcpy(total->name, name.ptr, name.len);
+  }
+
+  total->count += count;
+  total->wall_time += wall_time;
+  total->cpu_time += cpu_time;
+  return true;
+}
+
+typedef struct writer_s {
+  char *buffer;
+  size_t capacity;
+  size_t len; // may exceed capacity; only the part which fits is written
+} writer;
+
+static void write_bytes(writer *w, const char *bytes, size_t n) {
+  if (w->len < w->capacity) {
+    size_t room = w->capacity - w->len;
+    memcpy(w->buffer + w->len, bytes, n < room ? n : room);
+  }
+  w->len += n;
+}
+
+static void write_cstr(writer *w, const char *cstr) {
+  write_bytes(w, cstr, strlen(cstr));
+}
+
+static void write_i64(writer *w, int64_t value) {
+  char tmp[24];
+  int n = snprintf(tmp, sizeof tmp, "%" PRId64, value);
+  write_bytes(w, tmp, n > 0 ? (size_t)n : 0);
+}
+
+static void write_json_string(writer *w, const char *str, size_t len) {
+  write_bytes(w, "\"", 1);
+  for (size_t i = 0; i != len; ++i) {
+    unsigned char c = (unsigned char)str[i];
+    if (c == '"' || c == '\\') {
+      char escaped[2] = {'\\', (char)c};
+      write_bytes(w, escaped, sizeof escaped);
+    } else if (c < 0x20) {
+      char escaped[8];
+      int n = snprintf(escaped, sizeof escaped, "\\u%04x", c);
+      write_bytes(w, escaped, n > 0 ? (size_t)n : 0);
+    } else {
+      write_bytes(w, (const char *)&c, 1);
+    }
+  }
+  write_bytes(w, "\"", 1);
+}
+
+size_t
+datadog_php_endpoint_totals_json(const datadog_php_endpoint_totals *totals,
+                                 char *buffer, size_t capacity) {
+  writer w = {buffer, buffer ? capacity : 0, 0};
+  write_cstr(&w, "{\"endpoints\":[");
+  for (uint16_t i = 0; i != totals->len; ++i) {
+    const datadog_php_endpoint_total *total = &totals->totals[i];
+    write_cstr(&w, i ? ",{\"endpoint\":" : "{\"endpoint\":");
+    write_json_string(&w, total->name, total->name_len);
+    write_cstr(&w, ",\"sample\":");
+    write_i64(&w, total->count);
+    write_cstr(&w, ",\"wall-time\":");
+    write_i64(&w, total->wall_time);
+    write_cstr(&w, ",\"cpu-time\":");
+    write_i64(&w, total->cpu_time);
+    write_cstr(&w, "}");
+  }
+  write_cstr(&w, "]}");
+  return w.len;
+}
@@ -0,0 +1,59 @@
+#ifndef DATADOG_PHP_ENDPOINT_TOTALS_H
+#define DATADOG_PHP_ENDPOINT_TOTALS_H
+
+#include <components/string_view/string_view.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Aggregates sample values per trace endpoint so the most expensive endpoints
+ * can be seen next to the profile without aggregating it. Endpoints are
+ * few, so they're found by a linear scan. Names which don't fit are cut, like
+ * the trace endpoint label. Endpoints beyond the capacity aren't tracked.
+ */
+#define DATADOG_PHP_ENDPOINT_TOTALS_CAPACITY 64u
+#define DATADOG_PHP_ENDPOINT_TOTALS_NAME_CAPACITY 127u
+
+typedef struct datadog_php_endpoint_total_s {
+  int64_t count;
+  int64_t wall_time;
+  int64_t cpu_time;
+  uint8_t name_len;
+  char name[DATADOG_PHP_ENDPOINT_TOTALS_NAME_CAPACITY];
+} datadog_php_endpoint_total;
+
+typedef struct datadog_php_endpoint_totals_s {
+  uint16_t len;
+  datadog_php_endpoint_total totals[DATADOG_PHP_ENDPOINT_TOTALS_CAPACITY];
+} datadog_php_endpoint_totals;
+
+void datadog_php_endpoint_totals_ctor(datadog_php_endpoint_totals *totals);
+
+/**
+ * Forgets all endpoints, such as after the totals have been exported.
+ */
+void datadog_php_endpoint_totals_clear(datadog_php_endpoint_totals *totals);
+
+/**
+ * Adds the values to the total of `name`. Returns false if the endpoint isn't
+ * tracked yet and there is no room for it.
+ */
+bool datadog_php_endpoint_totals_add(datadog_php_endpoint_totals *totals,
+                                     datadog_php_string_view name,
+                                     int64_t count, int64_t wall_time,
+                                     int64_t cpu_time);
+
+/**
+ * Writes the totals as JSON, in the order endpoints were first added, e.g.
+ *   {"endpoints":[{"endpoint":"GET /users","sample":3,
+ *                  "wall-time":30000000,"cpu-time":29000000}]}
+ * Like snprintf, at most `capacity` bytes are written to `buffer` and the
+ * length of the whole document is returned, so passing a NULL buffer with a
+ * capacity of 0 gets the size to allocate. The output isn't null-terminated.
+ */
+size_t
+datadog_php_endpoint_totals_json(const datadog_php_endpoint_totals *totals,
+                                 char *buffer, size_t capacity);
+
+#endif // DATADOG_PHP_ENDPOINT_TOTALS_H
@@ -0,0 +1,88 @@
+extern "C" {
+#include <components/endpoint_totals/endpoint_totals.h>
+}
+
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+
+static std::string json(const datadog_php_endpoint_totals *totals) {
+  size_t len = datadog_php_endpoint_totals_json(totals, nullptr, 0);
+  std::string result(len, '\0');
+  REQUIRE(datadog_php_endpoint_totals_json(totals, &result[0], len) == len);
+  return result;
+}
+
+TEST_CASE("empty endpoint totals", "[endpoint_totals]") {
+  auto totals = std::make_unique<datadog_php_endpoint_totals>();
+  datadog_php_endpoint_totals_ctor(totals.get());
+
+  CHECK(json(totals.get()) == R"({"endpoints":[]})");
+}
+
+TEST_CASE("values are summed per endpoint", "[endpoint_totals]") {
+  auto totals = std::make_unique<datadog_php_endpoint_totals>();
+  datadog_php_endpoint_totals_ctor(totals.get());
+
+  auto users = datadog_php_string_view_from_cstr("GET /users");
+  auto login = datadog_php_string_view_from_cstr("POST /login");
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), users, 1, 10, 5));
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), login, 1, 20, 0));
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), users, 2, 40, 15));
+
+  CHECK(totals->len == 2);
+  CHECK(json(totals.get()) ==
+        R"({"endpoints":[)"
+        R"({"endpoint":"GET /users","sample":3,)"
+        R"("wall-time":50,"cpu-time":20},)"
+        R"({"endpoint":"POST /login","sample":1,)"
+        R"("wall-time":20,"cpu-time":0}]})");
+
+  datadog_php_endpoint_totals_clear(totals.get());
+  CHECK(json(totals.get()) == R"({"endpoints":[]})");
+}
+
+TEST_CASE("endpoint capacity", "[endpoint_totals]") {
+  auto totals = std::make_unique<datadog_php_endpoint_totals>();
+  datadog_php_endpoint_totals_ctor(totals.get());
+
+  for (unsigned i = 0; i != DATADOG_PHP_ENDPOINT_TOTALS_CAPACITY; ++i) {
+    std::string name = "GET /" + std::to_string(i);
+    datadog_php_string_view view = {name.size(), name.c_str()};
+    CHECK(datadog_php_endpoint_totals_add(totals.get(), view, 1, 1, 1));
+  }
+  auto extra = datadog_php_string_view_from_cstr("GET /extra");
+  CHECK(!datadog_php_endpoint_totals_add(totals.get(), extra, 1, 1, 1));
+
+  // endpoints which are already tracked can still be added to
+  auto seven = datadog_php_string_view_from_cstr("GET /7");
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), seven, 1, 1, 1));
+  CHECK(totals->totals[7].count == 2);
+}
+
+TEST_CASE("long endpoint names are cut", "[endpoint_totals]") {
+  auto totals = std::make_unique<datadog_php_endpoint_totals>();
+  datadog_php_endpoint_totals_ctor(totals.get());
+
+  std::string name = "GET /" + std::string(200, 'x');
+  datadog_php_string_view view = {name.size(), name.c_str()};
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), view, 1, 1, 1));
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), view, 1, 1, 1));
+
+  CHECK(totals->len == 1);
+  const datadog_php_endpoint_total *total = &totals->totals[0];
+  std::string kept(total->name, total->name_len);
+  CHECK(kept == name.substr(0, DATADOG_PHP_ENDPOINT_TOTALS_NAME_CAPACITY));
+  CHECK(total->count == 2);
+}
+
+TEST_CASE("json escapes endpoint names", "[endpoint_totals]") {
+  auto totals = std::make_unique<datadog_php_endpoint_totals>();
+  datadog_php_endpoint_totals_ctor(totals.get());
+
+  auto name = datadog_php_string_view_from_cstr("GET /\"a\"\\b\n");
+  CHECK(datadog_php_endpoint_totals_add(totals.get(), name, 1, 2, 3));
+  CHECK(json(totals.get()) ==
+        R"({"endpoints":[{"endpoint":"GET /\"a\"\\b\u000a",)"
+        R"("sample":1,"wall-time":2,"cpu-time":3}]})");
+}
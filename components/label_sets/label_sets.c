@@ -0,0 +1,153 @@
+#include "label_sets.h"
+
+#include <string.h>
+
+typedef datadog_php_string_view string_view_t;
+
+static bool equal(string_view_t a, string_view_t b) {
+  return datadog_php_string_view_equal(a, b);
+}
+
+static int compare(string_view_t a, string_view_t b) {
+  size_t n = a.len < b.len ? a.len : b.len;
+  int result = n ? memcmp(a.ptr, b.ptr, n) : 0;
+  if (result == 0) {
+    result = (a.len > b.len) - (a.len < b.len);
+  }
+  return result;
+}
+
+bool datadog_php_label_set_put(datadog_php_label_set *set, string_view_t key,
+                               string_view_t value) {
+  for (uint8_t i = 0; i != set->len; ++i) {
+    if (equal(set->labels[i].key, key)) {
+      set->labels[i].value = value;
+      return true;
+    }
+  }
+  if (set->len == DATADOG_PHP_LABEL_SET_CAPACITY) {
+    return false;
+  }
+  set->labels[set->len++] = (datadog_php_label){key, value};
+  return true;
+}
+
+bool datadog_php_label_set_remove(datadog_php_label_set *set,
+                                  string_view_t key) {
+  for (uint8_t i = 0; i != set->len; ++i) {
+    if (equal(set->labels[i].key, key)) {
+      set->labels[i] = set->labels[--set->len];
+      return true;
+    }
+  }
+  return false;
+}
+
+bool datadog_php_label_sets_ctor(datadog_php_label_sets *sets, uint32_t len,
+                                 uint8_t *buffer) {
+  sets->len = 0;
+  sets->arena = datadog_php_arena_new(len, buffer);
+  return sets->arena != NULL;
+}
+
+void datadog_php_label_sets_dtor(datadog_php_label_sets *sets) {
+  datadog_php_arena_delete(sets->arena);
+  sets->arena = NULL;
+  sets->len = 0;
+}
+
+void datadog_php_label_sets_clear(datadog_php_label_sets *sets) {
+  datadog_php_arena_reset(sets->arena);
+  sets->len = 0;
+}
+
+// FNV-1a over the keys and values, with a separator between each string.
+static uint64_t hash(const datadog_php_label_set *set) {
+  uint64_t h = UINT64_C(14695981039346656037);
+  for (uint8_t i = 0; i != set->len; ++i) {
+    string_view_t strs[2] = {set->labels[i].key, set->labels[i].value};
+    for (unsigned j = 0; j != 2; ++j) {
+      for (size_t k = 0; k != strs[j].len; ++k) {
+        h ^= (unsigned char)strs[j].ptr[k];
+        h *= UINT64_C(1099511628211);
+      }
+      h ^= 0xff;
+      h *= UINT64_C(1099511628211);
+    }
+  }
+  return h;
+}
+
+static bool set_equal(const datadog_php_label_set *a,
+                      const datadog_php_label_set *b) {
+  if (a->len != b->len) {
+    return false;
+  }
+  for (uint8_t i = 0; i != a->len; ++i) {
+    if (!equal(a->labels[i].key, b->labels[i].key) ||
+        !equal(a->labels[i].value, b->labels[i].value)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool copy_str(datadog_php_arena *arena, string_view_t *str) {
+  if (str->len > UINT32_MAX - 1) {
+    return false;
+  }
+  char *copy = datadog_php_arena_alloc_str(arena, (uint32_t)str->len, str->ptr);
+  if (!copy) {
+    return false;
+  }
+  str->ptr = copy;
+  return true;
+}
+
+bool datadog_php_label_sets_intern(datadog_php_label_sets *sets,
+                                   const datadog_php_label_set *set,
+                                   uint32_t *id) {
+  if (!set->len) {
+    *id = 0;
+    return true;
+  }
+
+  // Sort a copy by key, so the order the labels were set in doesn't matter.
+  datadog_php_label_set sorted = *set;
+  for (uint8_t i = 1; i < sorted.len; ++i) {
+    datadog_php_label label = sorted.labels[i];
+    uint8_t j = i;
+    for (; j && compare(sorted.labels[j - 1].key, label.key) > 0; --j) {
+      sorted.labels[j] = sorted.labels[j - 1];
+    }
+    sorted.labels[j] = label;
+  }
+
+  uint64_t h = hash(&sorted);
+  for (uint32_t i = 0; i != sets->len; ++i) {
+    if (sets->hashes[i] == h && set_equal(&sets->sets[i], &sorted)) {
+      *id = i + 1;
+      return true;
+    }
+  }
+
+  if (sets->len == DATADOG_PHP_LABEL_SETS_CAPACITY) {
+    return false;
+  }
+  for (uint8_t i = 0; i != sorted.len; ++i) {
+    if (!copy_str(sets->arena, &sorted.labels[i].key) ||
+        !copy_str(sets->arena, &sorted.labels[i].value)) {
+      return false;
+    }
+  }
+
+  sets->hashes[sets->len] = h;
+  sets->sets[sets->len] = sorted;
+  *id = ++sets->len;
+  return true;
+}
+
+const datadog_php_label_set *
+datadog_php_label_sets_get(const datadog_php_label_sets *sets, uint32_t id) {
+  return id && id <= sets->len ? &sets->sets[id - 1] : NULL;
+}
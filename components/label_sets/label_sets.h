@@ -0,0 +1,84 @@
+#ifndef DATADOG_PHP_LABEL_SETS_H
+#define DATADOG_PHP_LABEL_SETS_H
+
+#include <components/arena/arena.h>
+#include <components/string_view/string_view.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * A label set is a small list of custom key/value labels, such as a tenant id
+ * and a job type. Keys are unique within a set.
+ */
+#define DATADOG_PHP_LABEL_SET_CAPACITY 8u
+
+typedef struct datadog_php_label_s {
+  datadog_php_string_view key;
+  datadog_php_string_view value;
+} datadog_php_label;
+
+typedef struct datadog_php_label_set_s {
+  uint8_t len;
+  datadog_php_label labels[DATADOG_PHP_LABEL_SET_CAPACITY];
+} datadog_php_label_set;
+
+/**
+ * Sets `key` to `value` in the `set`, replacing the key's previous value if
+ * it has one. The strings aren't copied. Returns false if the set is full.
+ */
+bool datadog_php_label_set_put(datadog_php_label_set *set,
+                               datadog_php_string_view key,
+                               datadog_php_string_view value);
+
+/**
+ * Removes `key` from the `set`. Returns false if it wasn't there.
+ */
+bool datadog_php_label_set_remove(datadog_php_label_set *set,
+                                  datadog_php_string_view key);
+
+/**
+ * Label sets are interned so that a sample only needs to carry a small id to
+ * refer to its labels. Interned sets and their strings live until the table
+ * is cleared or destroyed, so pointers into them can be kept without holding
+ * a lock until then. The table isn't thread-safe by itself.
+ */
+#define DATADOG_PHP_LABEL_SETS_CAPACITY 1024u
+
+typedef struct datadog_php_label_sets_s {
+  datadog_php_arena *arena; // holds the strings
+  uint32_t len;
+  uint64_t hashes[DATADOG_PHP_LABEL_SETS_CAPACITY];
+  datadog_php_label_set sets[DATADOG_PHP_LABEL_SETS_CAPACITY];
+} datadog_php_label_sets;
+
+/**
+ * Creates the table, with strings stored in the `len` bytes of `buffer`.
+ * Returns false if the buffer is too small to be used.
+ */
+bool datadog_php_label_sets_ctor(datadog_php_label_sets *sets, uint32_t len,
+                                 uint8_t *buffer);
+void datadog_php_label_sets_dtor(datadog_php_label_sets *sets);
+
+/**
+ * Forgets every interned set and its strings, so that ids and pointers which
+ * the table handed out before are no longer valid.
+ */
+void datadog_php_label_sets_clear(datadog_php_label_sets *sets);
+
+/**
+ * Finds or adds a set with the same labels as `set`, in any order, and stores
+ * its id in `id`. The empty set always has the id 0. Returns false if the set
+ * is new and there is no room left for it or its strings.
+ */
+bool datadog_php_label_sets_intern(datadog_php_label_sets *sets,
+                                   const datadog_php_label_set *set,
+                                   uint32_t *id);
+
+/**
+ * Returns the interned set for `id`, or NULL for the empty set and ids which
+ * the table didn't hand out.
+ */
+const datadog_php_label_set *
+datadog_php_label_sets_get(const datadog_php_label_sets *sets, uint32_t id);
+
+#endif // DATADOG_PHP_LABEL_SETS_H
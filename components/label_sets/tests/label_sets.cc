@@ -0,0 +1,164 @@
+extern "C" {
+#include <components/label_sets/label_sets.h>
+}
+
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+
+static datadog_php_string_view sv(const char *str) {
+  return datadog_php_string_view_from_cstr(str);
+}
+
+static std::string str(datadog_php_string_view view) {
+  return std::string(view.ptr, view.len);
+}
+
+TEST_CASE("put and remove", "[label_sets]") {
+  datadog_php_label_set set = {};
+
+  CHECK(datadog_php_label_set_put(&set, sv("tenant"), sv("acme")));
+  CHECK(datadog_php_label_set_put(&set, sv("job"), sv("import")));
+  CHECK(datadog_php_label_set_put(&set, sv("tenant"), sv("globex")));
+  REQUIRE(set.len == 2);
+  CHECK(str(set.labels[0].value) == "globex");
+
+  CHECK(datadog_php_label_set_remove(&set, sv("tenant")));
+  CHECK(!datadog_php_label_set_remove(&set, sv("tenant")));
+  REQUIRE(set.len == 1);
+  CHECK(str(set.labels[0].key) == "job");
+}
+
+TEST_CASE("sets are full at capacity", "[label_sets]") {
+  datadog_php_label_set set = {};
+  std::string keys[DATADOG_PHP_LABEL_SET_CAPACITY];
+  for (unsigned i = 0; i != DATADOG_PHP_LABEL_SET_CAPACITY; ++i) {
+    keys[i] = "key" + std::to_string(i);
+    CHECK(datadog_php_label_set_put(&set, sv(keys[i].c_str()), sv("v")));
+  }
+  CHECK(!datadog_php_label_set_put(&set, sv("one more"), sv("v")));
+  // replacing a value still works
+  CHECK(datadog_php_label_set_put(&set, sv("key0"), sv("w")));
+}
+
+TEST_CASE("interning", "[label_sets]") {
+  auto sets = std::make_unique<datadog_php_label_sets>();
+  uint8_t buffer[4096];
+  REQUIRE(datadog_php_label_sets_ctor(sets.get(), sizeof buffer, buffer));
+
+  datadog_php_label_set empty = {};
+  uint32_t id = 42;
+  CHECK(datadog_php_label_sets_intern(sets.get(), &empty, &id));
+  CHECK(id == 0);
+  CHECK(datadog_php_label_sets_get(sets.get(), 0) == nullptr);
+
+  datadog_php_label_set a = {};
+  std::string tenant = "acme";
+  datadog_php_label_set_put(&a, sv("tenant"), sv(tenant.c_str()));
+  datadog_php_label_set_put(&a, sv("job"), sv("import"));
+
+  uint32_t a_id = 0;
+  CHECK(datadog_php_label_sets_intern(sets.get(), &a, &a_id));
+  CHECK(a_id == 1);
+
+  // the same labels in another order get the same id
+  datadog_php_label_set b = {};
+  datadog_php_label_set_put(&b, sv("job"), sv("import"));
+  datadog_php_label_set_put(&b, sv("tenant"), sv("acme"));
+  uint32_t b_id = 0;
+  CHECK(datadog_php_label_sets_intern(sets.get(), &b, &b_id));
+  CHECK(b_id == a_id);
+
+  datadog_php_label_set c = {};
+  datadog_php_label_set_put(&c, sv("tenant"), sv("acme"));
+  uint32_t c_id = 0;
+  CHECK(datadog_php_label_sets_intern(sets.get(), &c, &c_id));
+  CHECK(c_id == 2);
+
+  // interned strings are copies, sorted by key
+  tenant = "xxxx";
+  const datadog_php_label_set *interned =
+      datadog_php_label_sets_get(sets.get(), a_id);
+  REQUIRE(interned);
+  REQUIRE(interned->len == 2);
+  CHECK(str(interned->labels[0].key) == "job");
+  CHECK(str(interned->labels[0].value) == "import");
+  CHECK(str(interned->labels[1].key) == "tenant");
+  CHECK(str(interned->labels[1].value) == "acme");
+
+  CHECK(datadog_php_label_sets_get(sets.get(), 3) == nullptr);
+
+  datadog_php_label_sets_dtor(sets.get());
+}
+
+TEST_CASE("interning fails when out of room", "[label_sets]") {
+  auto sets = std::make_unique<datadog_php_label_sets>();
+  uint8_t buffer[256];
+  REQUIRE(datadog_php_label_sets_ctor(sets.get(), sizeof buffer, buffer));
+
+  std::string value(300, 'v');
+  datadog_php_label_set set = {};
+  datadog_php_label_set_put(&set, sv("key"), sv(value.c_str()));
+  uint32_t id = 0;
+  CHECK(!datadog_php_label_sets_intern(sets.get(), &set, &id));
+  CHECK(sets->len == 0);
+
+  datadog_php_label_sets_dtor(sets.get());
+}
+
+TEST_CASE("interning fails when the table is full", "[label_sets]") {
+  auto sets = std::make_unique<datadog_php_label_sets>();
+  auto buffer = std::make_unique<uint8_t[]>(1 << 16);
+  REQUIRE(datadog_php_label_sets_ctor(sets.get(), 1 << 16, buffer.get()));
+
+  uint32_t id = 0;
+  for (unsigned i = 0; i != DATADOG_PHP_LABEL_SETS_CAPACITY; ++i) {
+    std::string value = std::to_string(i);
+    datadog_php_label_set set = {};
+    datadog_php_label_set_put(&set, sv("tenant"), sv(value.c_str()));
+    REQUIRE(datadog_php_label_sets_intern(sets.get(), &set, &id));
+    CHECK(id == i + 1);
+  }
+
+  datadog_php_label_set set = {};
+  datadog_php_label_set_put(&set, sv("tenant"), sv("new"));
+  CHECK(!datadog_php_label_sets_intern(sets.get(), &set, &id));
+
+  // existing sets can still be found
+  datadog_php_label_set_put(&set, sv("tenant"), sv("7"));
+  CHECK(datadog_php_label_sets_intern(sets.get(), &set, &id));
+  CHECK(id == 8);
+
+  datadog_php_label_sets_dtor(sets.get());
+}
+
+TEST_CASE("clearing makes room again", "[label_sets]") {
+  auto sets = std::make_unique<datadog_php_label_sets>();
+  uint8_t buffer[512];
+  REQUIRE(datadog_php_label_sets_ctor(sets.get(), sizeof buffer, buffer));
+
+  std::string value(200, 'v');
+  datadog_php_label_set set = {};
+  datadog_php_label_set_put(&set, sv("key"), sv(value.c_str()));
+  uint32_t id = 0;
+  REQUIRE(datadog_php_label_sets_intern(sets.get(), &set, &id));
+  CHECK(id == 1);
+
+  datadog_php_label_set other = {};
+  datadog_php_label_set_put(&other, sv("other"), sv(value.c_str()));
+  datadog_php_label_set_put(&other, sv("key"), sv(value.c_str()));
+  CHECK(!datadog_php_label_sets_intern(sets.get(), &other, &id));
+
+  datadog_php_label_sets_clear(sets.get());
+  CHECK(sets->len == 0);
+  CHECK(datadog_php_label_sets_get(sets.get(), 1) == nullptr);
+
+  REQUIRE(datadog_php_label_sets_intern(sets.get(), &other, &id));
+  CHECK(id == 1);
+  const datadog_php_label_set *interned =
+      datadog_php_label_sets_get(sets.get(), id);
+  REQUIRE(interned);
+  CHECK(interned->len == 2);
+
+  datadog_php_label_sets_dtor(sets.get());
+}
@@ -0,0 +1,132 @@
+#include "line_totals.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#define SLOTS_LEN (DATADOG_PHP_LINE_TOTALS_CAPACITY * 2)
+
+void datadog_php_line_totals_ctor(datadog_php_line_totals *totals) {
+  datadog_php_line_totals_clear(totals);
+}
+
+void datadog_php_line_totals_clear(datadog_php_line_totals *totals) {
+  totals->len = 0;
+  memset(totals->slots, 0, sizeof totals->slots);
+}
+
+// FNV-1a over the file name, mixed with the line number.
+static uint64_t hash(datadog_php_string_view file, int64_t lineno) {
+  uint64_t h = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i != file.len; ++i) {
+    h ^= (unsigned char)file.ptr[i];
+    h *= UINT64_C(1099511628211);
+  }
+  h ^= (uint64_t)lineno;
+  h *= UINT64_C(1099511628211);
+  return h;
+}
+
+bool datadog_php_line_totals_add(datadog_php_line_totals *totals,
+                                 datadog_php_string_view file, int64_t lineno,
+                                 int64_t count, int64_t wall_time,
+                                 int64_t cpu_time) {
+  if (file.len > DATADOG_PHP_LINE_TOTALS_FILE_CAPACITY) {
+    size_t skip = file.len - DATADOG_PHP_LINE_TOTALS_FILE_CAPACITY;
+    file = (datadog_php_string_view){file.len - skip, file.ptr + skip};
+  }
+
+  size_t slot = (size_t)(hash(file, lineno) % SLOTS_LEN);
+  datadog_php_line_total *total = NULL;
+  while (totals->slots[slot]) {
+    datadog_php_line_total *candidate =
+        &totals->totals[totals->slots[slot] - 1];
+    if (candidate->lineno == lineno && candidate->file_len == file.len &&
+        memcmp(candidate->file, file.ptr, file.len) == 0) {
+      total = candidate;
+      break;
+    }
+    slot = (slot + 1) % SLOTS_LEN;
+  }
+
+  if (!total) {
+    if (totals->len == DATADOG_PHP_LINE_TOTALS_CAPACITY) {
+      return false;
+    }
+    total = &totals->totals[totals->len++];
+    totals->slots[slot] = totals->len;
+    total->lineno = lineno;
+    total->count = total->wall_time = total->cpu_time = 0;
+    total->file_len = (uint8_t)file.len;
+    memcpy(total->file, file.ptr, file.len);
+  }
+
+  total->count += count;
+  total->wall_time += wall_time;
+  total->cpu_time += cpu_time;
+  return true;
+}
+
+typedef struct writer_s {
+  char *buffer;
+  size_t capacity;
+  size_t len; // may exceed capacity; only the part which fits is written
+} writer;
+
+static void write_bytes(writer *w, const char *bytes, size_t n) {
+  if (w->len < w->capacity) {
+    size_t room = w->capacity - w->len;
+    memcpy(w->buffer + w->len, bytes, n < room ? n : room);
+  }
+  w->len += n;
+}
+
+static void write_cstr(writer *w, const char *cstr) {
+  write_bytes(w, cstr, strlen(cstr));
+}
+
+static void write_i64(writer *w, int64_t value) {
+  char tmp[24];
+  int n = snprintf(tmp, sizeof tmp, "%" PRId64, value);
+  write_bytes(w, tmp, n > 0 ? (size_t)n : 0);
+}
+
+static void write_json_string(writer *w, const char *str, size_t len) {
+  write_bytes(w, "\"", 1);
+  for (size_t i = 0; i != len; ++i) {
+    unsigned char c = (unsigned char)str[i];
+    if (c == '"' || c == '\\') {
+      char escaped[2] = {'\\', (char)c};
+      write_bytes(w, escaped, sizeof escaped);
+    } else if (c < 0x20) {
+      char escaped[8];
+      int n = snprintf(escaped, sizeof escaped, "\\u%04x", c);
+      write_bytes(w, escaped, n > 0 ? (size_t)n : 0);
+    } else {
+      write_bytes(w, (const char *)&c, 1);
+    }
+  }
+  write_bytes(w, "\"", 1);
+}
+
+size_t datadog_php_line_totals_json(const datadog_php_line_totals *totals,
+                                    char *buffer, size_t capacity) {
+  writer w = {buffer, buffer ? capacity : 0, 0};
+  write_cstr(&w, "{\"lines\":[");
+  for (uint16_t i = 0; i != totals->len; ++i) {
+    const datadog_php_line_total *total = &totals->totals[i];
+    write_cstr(&w, i ? ",{\"file\":" : "{\"file\":");
+    write_json_string(&w, total->file, total->file_len);
+    write_cstr(&w, ",\"line\":");
+    write_i64(&w, total->lineno);
+    write_cstr(&w, ",\"sample\":");
+    write_i64(&w, total->count);
+    write_cstr(&w, ",\"wall-time\":");
+    write_i64(&w, total->wall_time);
+    write_cstr(&w, ",\"cpu-time\":");
+    write_i64(&w, total->cpu_time);
+    write_cstr(&w, "}");
+  }
+  write_cstr(&w, "]}");
+  return w.len;
+}
@@ -0,0 +1,63 @@
+#ifndef DATADOG_PHP_LINE_TOTALS_H
+#define DATADOG_PHP_LINE_TOTALS_H
+
+#include <components/string_view/string_view.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Aggregates sample values per (file, line) so the hottest lines of a period
+ * can be exported next to the profile. File names are copied, keeping the end
+ * of names which don't fit, as that's the part which tells files apart. Lines
+ * beyond the capacity in a period aren't tracked.
+ */
+#define DATADOG_PHP_LINE_TOTALS_CAPACITY 256u
+#define DATADOG_PHP_LINE_TOTALS_FILE_CAPACITY 255u
+
+typedef struct datadog_php_line_total_s {
+  int64_t lineno;
+  int64_t count;
+  int64_t wall_time;
+  int64_t cpu_time;
+  uint8_t file_len;
+  char file[DATADOG_PHP_LINE_TOTALS_FILE_CAPACITY];
+} datadog_php_line_total;
+
+typedef struct datadog_php_line_totals_s {
+  uint16_t len;
+  /* An open-addressing index into `totals`; each slot holds an index plus 1,
+   * or 0 if the slot is free. It has twice the capacity to keep probes short.
+   */
+  uint16_t slots[DATADOG_PHP_LINE_TOTALS_CAPACITY * 2];
+  datadog_php_line_total totals[DATADOG_PHP_LINE_TOTALS_CAPACITY];
+} datadog_php_line_totals;
+
+void datadog_php_line_totals_ctor(datadog_php_line_totals *totals);
+
+/**
+ * Forgets all lines, such as after the totals have been exported.
+ */
+void datadog_php_line_totals_clear(datadog_php_line_totals *totals);
+
+/**
+ * Adds the values to the total of `file` at `lineno`. Returns false if the
+ * line isn't tracked yet and there is no room for it.
+ */
+bool datadog_php_line_totals_add(datadog_php_line_totals *totals,
+                                 datadog_php_string_view file, int64_t lineno,
+                                 int64_t count, int64_t wall_time,
+                                 int64_t cpu_time);
+
+/**
+ * Writes the totals as JSON, in the order lines were first added, e.g.
+ *   {"lines":[{"file":"/app/index.php","line":12,"sample":3,
+ *              "wall-time":30000000,"cpu-time":29000000}]}
+ * Like snprintf, at most `capacity` bytes are written to `buffer` and the
+ * length of the whole document is returned, so passing a NULL buffer with a
+ * capacity of 0 gets the size to allocate. The output isn't null-terminated.
+ */
+size_t datadog_php_line_totals_json(const datadog_php_line_totals *totals,
+                                    char *buffer, size_t capacity);
+
+#endif // DATADOG_PHP_LINE_TOTALS_H
@@ -0,0 +1,97 @@
+extern "C" {
+#include <components/line_totals/line_totals.h>
+}
+
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+
+static std::string json(const datadog_php_line_totals *totals) {
+  size_t len = datadog_php_line_totals_json(totals, nullptr, 0);
+  std::string result(len, '\0');
+  REQUIRE(datadog_php_line_totals_json(totals, &result[0], len) == len);
+  return result;
+}
+
+TEST_CASE("empty totals", "[line_totals]") {
+  auto totals = std::make_unique<datadog_php_line_totals>();
+  datadog_php_line_totals_ctor(totals.get());
+
+  CHECK(json(totals.get()) == R"({"lines":[]})");
+}
+
+TEST_CASE("values are summed per file and line", "[line_totals]") {
+  auto totals = std::make_unique<datadog_php_line_totals>();
+  datadog_php_line_totals_ctor(totals.get());
+
+  auto a = datadog_php_string_view_from_cstr("/app/a.php");
+  auto b = datadog_php_string_view_from_cstr("/app/b.php");
+  CHECK(datadog_php_line_totals_add(totals.get(), a, 3, 1, 10, 5));
+  CHECK(datadog_php_line_totals_add(totals.get(), b, 3, 1, 20, 0));
+  CHECK(datadog_php_line_totals_add(totals.get(), a, 4, 1, 30, 0));
+  CHECK(datadog_php_line_totals_add(totals.get(), a, 3, 2, 40, 15));
+
+  CHECK(totals->len == 3);
+  CHECK(json(totals.get()) ==
+        R"({"lines":[)"
+        R"({"file":"/app/a.php","line":3,"sample":3,)"
+        R"("wall-time":50,"cpu-time":20},)"
+        R"({"file":"/app/b.php","line":3,"sample":1,)"
+        R"("wall-time":20,"cpu-time":0},)"
+        R"({"file":"/app/a.php","line":4,"sample":1,)"
+        R"("wall-time":30,"cpu-time":0}]})");
+
+  datadog_php_line_totals_clear(totals.get());
+  CHECK(json(totals.get()) == R"({"lines":[]})");
+}
+
+TEST_CASE("capacity", "[line_totals]") {
+  auto totals = std::make_unique<datadog_php_line_totals>();
+  datadog_php_line_totals_ctor(totals.get());
+
+  auto file = datadog_php_string_view_from_cstr("/app/a.php");
+  for (int64_t i = 0; i != DATADOG_PHP_LINE_TOTALS_CAPACITY; ++i) {
+    CHECK(datadog_php_line_totals_add(totals.get(), file, i, 1, 1, 1));
+  }
+  CHECK(!datadog_php_line_totals_add(totals.get(), file, -1, 1, 1, 1));
+
+  // lines which are already tracked can still be added to
+  CHECK(datadog_php_line_totals_add(totals.get(), file, 7, 1, 1, 1));
+  CHECK(totals->totals[7].count == 2);
+}
+
+TEST_CASE("long file names keep their end", "[line_totals]") {
+  auto totals = std::make_unique<datadog_php_line_totals>();
+  datadog_php_line_totals_ctor(totals.get());
+
+  std::string file(300, 'x');
+  file += "/index.php";
+  datadog_php_string_view view = {file.size(), file.c_str()};
+  CHECK(datadog_php_line_totals_add(totals.get(), view, 1, 1, 1, 1));
+
+  const datadog_php_line_total *total = &totals->totals[0];
+  std::string kept(total->file, total->file_len);
+  CHECK(kept.size() == DATADOG_PHP_LINE_TOTALS_FILE_CAPACITY);
+  CHECK(kept == file.substr(file.size() - kept.size()));
+}
+
+TEST_CASE("json escapes file names", "[line_totals]") {
+  auto totals = std::make_unique<datadog_php_line_totals>();
+  datadog_php_line_totals_ctor(totals.get());
+
+  auto file = datadog_php_string_view_from_cstr("C:\\app\\\"a\".php\n");
+  CHECK(datadog_php_line_totals_add(totals.get(), file, 1, 1, 2, 3));
+  CHECK(json(totals.get()) ==
+        R"({"lines":[{"file":"C:\\app\\\"a\".php\u000a","line":1,)"
+        R"("sample":1,"wall-time":2,"cpu-time":3}]})");
+}
+
+TEST_CASE("json is truncated to the capacity", "[line_totals]") {
+  auto totals = std::make_unique<datadog_php_line_totals>();
+  datadog_php_line_totals_ctor(totals.get());
+
+  char buffer[8] = {'#', '#', '#', '#', '#', '#', '#', '#'};
+  size_t len = datadog_php_line_totals_json(totals.get(), buffer, 4);
+  CHECK(len == sizeof(R"({"lines":[]})") - 1);
+  CHECK(std::string(buffer, sizeof buffer) == R"({"li####)");
+}
@@ -0,0 +1,35 @@
+#include "prng.h"
+
+void datadog_php_prng_ctor(datadog_php_prng *prng, uint64_t seed) {
+  prng->state = seed;
+}
+
+uint64_t datadog_php_prng_next(datadog_php_prng *prng) {
+  // splitmix64, see https://prng.di.unimi.it/splitmix64.c
+  uint64_t z = (prng->state += UINT64_C(0x9e3779b97f4a7c15));
+  z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+  z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+  return z ^ (z >> 31);
+}
+
+uint64_t datadog_php_prng_below(datadog_php_prng *prng, uint64_t bound) {
+  if (bound <= 1) {
+    return 0;
+  }
+
+  /* Reject the values in the incomplete last "bucket" so that the result is
+   * not biased towards small numbers. At most half the range is rejected, so
+   * this loops twice on average in the worst case.
+   */
+  uint64_t threshold = -bound % bound;
+  uint64_t value;
+  do {
+    value = datadog_php_prng_next(prng);
+  } while (value < threshold);
+  return value % bound;
+}
+
+double datadog_php_prng_next_double(datadog_php_prng *prng) {
+  // The top 53 bits fit exactly into a double's mantissa.
+  return (double)(datadog_php_prng_next(prng) >> 11) * 0x1.0p-53;
+}
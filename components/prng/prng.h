@@ -0,0 +1,38 @@
+#ifndef DATADOG_PHP_PRNG_H
+#define DATADOG_PHP_PRNG_H
+
+#include <stdint.h>
+
+/**
+ * A small, fast pseudo-random number generator (splitmix64) for sampling
+ * decisions. It is NOT cryptographically secure, and it is NOT thread-safe;
+ * give each thread its own generator.
+ *
+ * We do not use PHP's mt_rand because it would perturb the sequence of users
+ * who seed it with mt_srand, and we do not use php_random_bytes for every
+ * decision because it may be a syscall.
+ */
+typedef struct datadog_php_prng_s {
+  // private:
+  uint64_t state;
+} datadog_php_prng;
+
+/**
+ * Seeds the generator. Any seed is acceptable, including 0.
+ */
+void datadog_php_prng_ctor(datadog_php_prng *prng, uint64_t seed);
+
+uint64_t datadog_php_prng_next(datadog_php_prng *prng);
+
+/**
+ * Returns a uniformly distributed integer in [0, bound). A `bound` of 0 is
+ * treated as 1, so 0 is returned.
+ */
+uint64_t datadog_php_prng_below(datadog_php_prng *prng, uint64_t bound);
+
+/**
+ * Returns a uniformly distributed double in [0, 1).
+ */
+double datadog_php_prng_next_double(datadog_php_prng *prng);
+
+#endif // DATADOG_PHP_PRNG_H
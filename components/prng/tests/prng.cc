@@ -0,0 +1,62 @@
+extern "C" {
+#include <components/prng/prng.h>
+}
+
+#include <catch2/catch.hpp>
+
+TEST_CASE("same seed same sequence", "[prng]") {
+  datadog_php_prng a, b;
+  datadog_php_prng_ctor(&a, 42);
+  datadog_php_prng_ctor(&b, 42);
+
+  for (unsigned i = 0; i != 100; ++i) {
+    CHECK(datadog_php_prng_next(&a) == datadog_php_prng_next(&b));
+  }
+}
+
+TEST_CASE("different seeds different sequences", "[prng]") {
+  datadog_php_prng a, b;
+  datadog_php_prng_ctor(&a, 0);
+  datadog_php_prng_ctor(&b, 1);
+
+  CHECK(datadog_php_prng_next(&a) != datadog_php_prng_next(&b));
+}
+
+TEST_CASE("below respects bound", "[prng]") {
+  datadog_php_prng prng;
+  datadog_php_prng_ctor(&prng, 7);
+
+  CHECK(datadog_php_prng_below(&prng, 0) == 0u);
+  CHECK(datadog_php_prng_below(&prng, 1) == 0u);
+
+  bool seen[10] = {false};
+  for (unsigned i = 0; i != 1000; ++i) {
+    uint64_t value = datadog_php_prng_below(&prng, 10);
+    REQUIRE(value < 10u);
+    seen[value] = true;
+  }
+
+  // With 1000 draws every bucket should have been hit.
+  for (bool hit : seen) {
+    CHECK(hit);
+  }
+}
+
+TEST_CASE("next_double is in [0, 1)", "[prng]") {
+  datadog_php_prng prng;
+  datadog_php_prng_ctor(&prng, 13);
+
+  double sum = 0.0;
+  const unsigned n = 10000;
+  for (unsigned i = 0; i != n; ++i) {
+    double value = datadog_php_prng_next_double(&prng);
+    REQUIRE(value >= 0.0);
+    REQUIRE(value < 1.0);
+    sum += value;
+  }
+
+  // Very loose check that it is roughly uniform.
+  double mean = sum / n;
+  CHECK(mean > 0.45);
+  CHECK(mean < 0.55);
+}
@@ -4,8 +4,8 @@
 
 /* Done in the impl instead of the header because on CentOS 6 in gnu++11 mode
  * it fails in the header. The header gets included in C++ mode for testing. */
-_Static_assert(sizeof(struct datadog_php_stack_sample_s) < 8192u,
-               "size of datadog_php_stack_sample should be less than 8KiB");
+_Static_assert(sizeof(struct datadog_php_stack_sample_s) < 9216u,
+               "size of datadog_php_stack_sample should be less than 9KiB");
 
 typedef datadog_php_stack_sample stack_sample_t;
 typedef datadog_php_stack_sample_frame stack_sample_frame_t;
@@ -60,6 +60,10 @@ bool datadog_php_stack_sample_try_add(stack_sample_t *sample,
   if (depth >= datadog_php_stack_sample_max_depth) {
     return false;
   }
+  if (frame.native &&
+      sample->native_len >= DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH) {
+    return false;
+  }
 
   uint16_t function_off;
   if (!try_add_string(sample, frame.function, &function_off)) {
@@ -76,6 +80,15 @@ bool datadog_php_stack_sample_try_add(stack_sample_t *sample,
   sample->file_len[depth] = frame.file.len;
 
   sample->lineno[depth] = frame.lineno;
+  sample->native[depth] = 0;
+  if (frame.native) {
+    uint8_t index = sample->native_len++;
+    sample->native_frames[index].address = frame.address;
+    sample->native_frames[index].mapping_start = frame.mapping_start;
+    sample->native_frames[index].mapping_limit = frame.mapping_limit;
+    sample->native_frames[index].mapping_offset = frame.mapping_offset;
+    sample->native[depth] = index + 1;
+  }
   ++sample->depth;
 
   return true;
@@ -120,6 +133,14 @@ datadog_php_stack_sample_iterator_frame(stack_sample_iterator_t *iterator) {
       .file = {file_len, file},
       .lineno = sample->lineno[depth],
   };
+  if (sample->native[depth]) {
+    uint8_t index = sample->native[depth] - 1;
+    frame.native = true;
+    frame.address = sample->native_frames[index].address;
+    frame.mapping_start = sample->native_frames[index].mapping_start;
+    frame.mapping_limit = sample->native_frames[index].mapping_limit;
+    frame.mapping_offset = sample->native_frames[index].mapping_offset;
+  }
   return frame;
 }
 
@@ -2,12 +2,15 @@
 #define DATADOG_PHP_STACK_SAMPLE_H
 
 #include <components/string_view/string_view.h>
+#include <stdbool.h>
 #include <stdint.h>
 
 #define DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH 99u
 static const uint16_t datadog_php_stack_sample_max_depth =
     DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH;
 
+#define DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH 16u
+
 /**
  * A stack sample represents a stack sample in a serialized form that is not
  * aware of any language runtime specific things. This layout could be more
@@ -32,6 +35,19 @@ typedef struct datadog_php_stack_sample_s {
   uint16_t file_len[DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH + 1];
   int64_t lineno[DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH + 1];
 
+  /* Few frames are native, so their addresses and mappings are kept aside.
+   * For each frame, native holds the index of its entry plus 1, or 0 if the
+   * frame isn't native.
+   */
+  uint8_t native_len;
+  uint8_t native[DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH + 1];
+  struct {
+    uint64_t address;
+    uint64_t mapping_start;
+    uint64_t mapping_limit;
+    uint64_t mapping_offset;
+  } native_frames[DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH];
+
   /* The strings need to point into this buffer. It's sized so that there are
    * 64 bytes per entry, which on average may not be enough, but does allow for
    * deeper stacks if the function and file names are on the shorter side.
@@ -39,10 +55,22 @@ typedef struct datadog_php_stack_sample_s {
   char buffer[(DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH + 1) * 64u];
 } datadog_php_stack_sample;
 
+/**
+ * Native frames are machine code rather than PHP code. Their `file` is the path
+ * of the shared object which contains the code, `address` is where the code is
+ * in memory, and the mapping is where the object's segment which contains it
+ * was loaded from the file. They have no line. A sample can hold up to
+ * DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH native frames.
+ */
 typedef struct datadog_php_stack_sample_frame_s {
   datadog_php_string_view function;
   datadog_php_string_view file;
   int64_t lineno;
+  bool native;
+  uint64_t address;
+  uint64_t mapping_start;
+  uint64_t mapping_limit;
+  uint64_t mapping_offset;
 } datadog_php_stack_sample_frame;
 
 void datadog_php_stack_sample_ctor(datadog_php_stack_sample *);
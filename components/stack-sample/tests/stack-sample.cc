@@ -39,7 +39,7 @@ TEST_CASE("iterator", "[stack-sample]") {
 
   const datadog_php_stack_sample_frame main_frame = {
       datadog_php_string_view_from_cstr("{main}"),
-      datadog_php_string_view_from_cstr("/srv/public/index.php"), 3};
+      datadog_php_string_view_from_cstr("/srv/public/index.php"), 3, false};
   CHECK(datadog_php_stack_sample_try_add(&sample, main_frame));
 
   CHECK(datadog_php_stack_sample_depth(&sample) == 1u);
@@ -62,3 +62,88 @@ TEST_CASE("iterator", "[stack-sample]") {
   datadog_php_stack_sample_iterator_dtor(&iterator);
   datadog_php_stack_sample_dtor(&sample);
 }
+
+TEST_CASE("native frames", "[stack-sample]") {
+  datadog_php_stack_sample sample;
+  datadog_php_stack_sample_ctor(&sample);
+
+  const datadog_php_stack_sample_frame native_frame = {
+      datadog_php_string_view_from_cstr("ResizeImage"),
+      datadog_php_string_view_from_cstr("/usr/lib/libMagickCore.so.6"),
+      0,
+      true,
+      0x7f00000a1f40,
+      0x7f0000080000,
+      0x7f0000200000,
+      0x40000};
+  const datadog_php_stack_sample_frame internal_frame = {
+      datadog_php_string_view_from_cstr("imagick|Imagick::resizeImage"),
+      DATADOG_PHP_STRING_VIEW_INIT, 0, false};
+  const datadog_php_stack_sample_frame php_frame = {
+      datadog_php_string_view_from_cstr("{main}"),
+      datadog_php_string_view_from_cstr("/srv/public/index.php"), 3, false};
+  CHECK(datadog_php_stack_sample_try_add(&sample, native_frame));
+  CHECK(datadog_php_stack_sample_try_add(&sample, internal_frame));
+  CHECK(datadog_php_stack_sample_try_add(&sample, php_frame));
+
+  auto iterator = datadog_php_stack_sample_iterator_ctor(&sample);
+  REQUIRE(datadog_php_stack_sample_iterator_valid(&iterator));
+  auto frame = datadog_php_stack_sample_iterator_frame(&iterator);
+  CHECK(frame.native);
+  CHECK(datadog_php_string_view_equal(frame.function, native_frame.function));
+  CHECK(datadog_php_string_view_equal(frame.file, native_frame.file));
+  CHECK(frame.lineno == 0);
+  CHECK(frame.address == native_frame.address);
+  CHECK(frame.mapping_start == native_frame.mapping_start);
+  CHECK(frame.mapping_limit == native_frame.mapping_limit);
+  CHECK(frame.mapping_offset == native_frame.mapping_offset);
+
+  datadog_php_stack_sample_iterator_next(&iterator);
+  REQUIRE(datadog_php_stack_sample_iterator_valid(&iterator));
+  frame = datadog_php_stack_sample_iterator_frame(&iterator);
+  CHECK(!frame.native);
+  CHECK(frame.address == 0);
+
+  datadog_php_stack_sample_iterator_next(&iterator);
+  REQUIRE(datadog_php_stack_sample_iterator_valid(&iterator));
+  frame = datadog_php_stack_sample_iterator_frame(&iterator);
+  CHECK(!frame.native);
+  CHECK(frame.lineno == 3);
+
+  datadog_php_stack_sample_iterator_dtor(&iterator);
+  datadog_php_stack_sample_dtor(&sample);
+}
+
+TEST_CASE("native frames capacity", "[stack-sample]") {
+  datadog_php_stack_sample sample;
+  datadog_php_stack_sample_ctor(&sample);
+
+  datadog_php_stack_sample_frame native_frame = {
+      datadog_php_string_view_from_cstr("memcpy"),
+      datadog_php_string_view_from_cstr("/lib/libc.so.6"), 0, true};
+  for (unsigned i = 0; i != DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH; ++i) {
+    native_frame.address = i;
+    CHECK(datadog_php_stack_sample_try_add(&sample, native_frame));
+  }
+  CHECK(!datadog_php_stack_sample_try_add(&sample, native_frame));
+
+  // PHP frames still fit.
+  const datadog_php_stack_sample_frame php_frame = {
+      datadog_php_string_view_from_cstr("{main}"),
+      datadog_php_string_view_from_cstr("/srv/public/index.php"), 3, false};
+  CHECK(datadog_php_stack_sample_try_add(&sample, php_frame));
+  CHECK(datadog_php_stack_sample_depth(&sample) ==
+        DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH + 1);
+
+  auto iterator = datadog_php_stack_sample_iterator_ctor(&sample);
+  for (unsigned i = 0; i != DATADOG_PHP_STACK_SAMPLE_MAX_NATIVE_DEPTH; ++i) {
+    REQUIRE(datadog_php_stack_sample_iterator_valid(&iterator));
+    auto frame = datadog_php_stack_sample_iterator_frame(&iterator);
+    CHECK(frame.native);
+    CHECK(frame.address == i);
+    datadog_php_stack_sample_iterator_next(&iterator);
+  }
+
+  datadog_php_stack_sample_iterator_dtor(&iterator);
+  datadog_php_stack_sample_dtor(&sample);
+}
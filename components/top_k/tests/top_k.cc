@@ -0,0 +1,108 @@
+extern "C" {
+#include <components/top_k/top_k.h>
+}
+
+#include <catch2/catch.hpp>
+#include <memory>
+#include <string>
+
+static std::string key_of(const datadog_php_top_k_entry *entry) {
+  return std::string(entry->key, entry->key_len);
+}
+
+TEST_CASE("empty summary", "[top_k]") {
+  auto top = std::make_unique<datadog_php_top_k>();
+  datadog_php_top_k_ctor(top.get());
+
+  const datadog_php_top_k_entry *entries[4];
+  CHECK(datadog_php_top_k_heaviest(top.get(), 4, entries) == 0);
+}
+
+TEST_CASE("values are summed per key", "[top_k]") {
+  auto top = std::make_unique<datadog_php_top_k>();
+  datadog_php_top_k_ctor(top.get());
+
+  auto a = datadog_php_string_view_from_cstr("a");
+  auto b = datadog_php_string_view_from_cstr("b");
+  datadog_php_top_k_add(top.get(), a, 5, 1, 10, 5);
+  datadog_php_top_k_add(top.get(), b, 20, 1, 20, 20);
+  datadog_php_top_k_add(top.get(), a, 25, 2, 40, 25);
+
+  const datadog_php_top_k_entry *entries[4];
+  REQUIRE(datadog_php_top_k_heaviest(top.get(), 4, entries) == 2);
+  CHECK(key_of(entries[0]) == "a");
+  CHECK(entries[0]->weight == 30);
+  CHECK(entries[0]->error == 0);
+  CHECK(entries[0]->count == 3);
+  CHECK(entries[0]->wall_time == 50);
+  CHECK(entries[0]->cpu_time == 30);
+  CHECK(key_of(entries[1]) == "b");
+  CHECK(entries[1]->weight == 20);
+
+  datadog_php_top_k_clear(top.get());
+  CHECK(datadog_php_top_k_heaviest(top.get(), 4, entries) == 0);
+}
+
+TEST_CASE("heaviest keeps only the first n", "[top_k]") {
+  auto top = std::make_unique<datadog_php_top_k>();
+  datadog_php_top_k_ctor(top.get());
+
+  int64_t weights[] = {3, 9, 1, 7, 5};
+  const char *keys[] = {"c", "i", "a", "g", "e"};
+  for (int i = 0; i != 5; ++i) {
+    auto key = datadog_php_string_view_from_cstr(keys[i]);
+    datadog_php_top_k_add(top.get(), key, weights[i], 1, 0, 0);
+  }
+
+  const datadog_php_top_k_entry *entries[3];
+  REQUIRE(datadog_php_top_k_heaviest(top.get(), 3, entries) == 3);
+  CHECK(key_of(entries[0]) == "i");
+  CHECK(key_of(entries[1]) == "g");
+  CHECK(key_of(entries[2]) == "e");
+}
+
+TEST_CASE("the lightest key is evicted when full", "[top_k]") {
+  auto top = std::make_unique<datadog_php_top_k>();
+  datadog_php_top_k_ctor(top.get());
+
+  for (int i = 0; i != DATADOG_PHP_TOP_K_CAPACITY; ++i) {
+    std::string key = "key" + std::to_string(i);
+    datadog_php_string_view view = {key.size(), key.data()};
+    datadog_php_top_k_add(top.get(), view, i == 7 ? 1 : 10, 1, 1, 1);
+  }
+  CHECK(top->len == DATADOG_PHP_TOP_K_CAPACITY);
+
+  auto hot = datadog_php_string_view_from_cstr("hot");
+  datadog_php_top_k_add(top.get(), hot, 100, 1, 2, 3);
+  CHECK(top->len == DATADOG_PHP_TOP_K_CAPACITY);
+
+  // key7 was the lightest, so "hot" took its place and inherited its weight
+  const datadog_php_top_k_entry *entry = &top->entries[7];
+  CHECK(key_of(entry) == "hot");
+  CHECK(entry->weight == 101);
+  CHECK(entry->error == 1);
+  CHECK(entry->count == 1);
+  CHECK(entry->wall_time == 2);
+  CHECK(entry->cpu_time == 3);
+
+  const datadog_php_top_k_entry *entries[1];
+  REQUIRE(datadog_php_top_k_heaviest(top.get(), 1, entries) == 1);
+  CHECK(entries[0] == entry);
+}
+
+TEST_CASE("long keys keep their end", "[top_k]") {
+  auto top = std::make_unique<datadog_php_top_k>();
+  datadog_php_top_k_ctor(top.get());
+
+  std::string key(DATADOG_PHP_TOP_K_KEY_CAPACITY + 10, 'x');
+  key += ";leaf";
+  datadog_php_string_view view = {key.size(), key.data()};
+  datadog_php_top_k_add(top.get(), view, 1, 1, 1, 1);
+  datadog_php_top_k_add(top.get(), view, 1, 1, 1, 1);
+
+  REQUIRE(top->len == 1);
+  std::string stored = key_of(&top->entries[0]);
+  CHECK(stored.size() == DATADOG_PHP_TOP_K_KEY_CAPACITY);
+  CHECK(stored == key.substr(key.size() - DATADOG_PHP_TOP_K_KEY_CAPACITY));
+  CHECK(top->entries[0].count == 2);
+}
@@ -0,0 +1,84 @@
+#include "top_k.h"
+
+#include <string.h>
+
+void datadog_php_top_k_ctor(datadog_php_top_k *top) {
+  datadog_php_top_k_clear(top);
+}
+
+void datadog_php_top_k_clear(datadog_php_top_k *top) { top->len = 0; }
+
+// FNV-1a
+static uint64_t hash(datadog_php_string_view key) {
+  uint64_t h = UINT64_C(14695981039346656037);
+  for (size_t i = 0; i != key.len; ++i) {
+    h ^= (unsigned char)key.ptr[i];
+    h *= UINT64_C(1099511628211);
+  }
+  return h;
+}
+
+void datadog_php_top_k_add(datadog_php_top_k *top, datadog_php_string_view key,
+                           int64_t weight, int64_t count, int64_t wall_time,
+                           int64_t cpu_time) {
+  if (key.len > DATADOG_PHP_TOP_K_KEY_CAPACITY) {
+    size_t skip = key.len - DATADOG_PHP_TOP_K_KEY_CAPACITY;
+    key = (datadog_php_string_view){key.len - skip, key.ptr + skip};
+  }
+
+  /* The summary is small enough that a scan is cheap, and it needs one to
+   * find the lightest entry anyway.
+   */
+  uint64_t h = hash(key);
+  datadog_php_top_k_entry *entry = NULL, *lightest = NULL;
+  for (uint16_t i = 0; i != top->len; ++i) {
+    datadog_php_top_k_entry *candidate = &top->entries[i];
+    if (candidate->hash == h && candidate->key_len == key.len &&
+        memcmp(candidate->key, key.ptr, key.len) == 0) {
+      entry = candidate;
+      break;
+    }
+    if (!lightest || candidate->weight < lightest->weight) {
+      lightest = candidate;
+    }
+  }
+
+  if (!entry) {
+    if (top->len != DATADOG_PHP_TOP_K_CAPACITY) {
+      entry = &top->entries[top->len++];
+      entry->weight = entry->error = 0;
+    } else {
+      entry = lightest;
+      entry->error = entry->weight;
+    }
+    entry->hash = h;
+    entry->count = entry->wall_time = entry->cpu_time = 0;
+    entry->key_len = (uint16_t)key.len;
+    memcpy(entry->key, key.ptr, key.len);
+  }
+
+  entry->weight += weight;
+  entry->count += count;
+  entry->wall_time += wall_time;
+  entry->cpu_time += cpu_time;
+}
+
+size_t datadog_php_top_k_heaviest(const datadog_php_top_k *top, size_t n,
+                                  const datadog_php_top_k_entry *entries[]) {
+  // An insertion sort which only keeps the heaviest n.
+  size_t len = 0;
+  for (uint16_t i = 0; i != top->len; ++i) {
+    const datadog_php_top_k_entry *entry = &top->entries[i];
+    size_t j = len < n ? len++ : len;
+    while (j && entries[j - 1]->weight < entry->weight) {
+      if (j < n) {
+        entries[j] = entries[j - 1];
+      }
+      --j;
+    }
+    if (j < n) {
+      entries[j] = entry;
+    }
+  }
+  return len;
+}
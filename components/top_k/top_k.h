@@ -0,0 +1,59 @@
+#ifndef DATADOG_PHP_TOP_K_H
+#define DATADOG_PHP_TOP_K_H
+
+#include <components/string_view/string_view.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A running summary of the heaviest keys, such as function names, using the
+ * space-saving algorithm: when a new key arrives while the summary is full, it
+ * replaces the lightest entry and inherits its weight as `error`. An entry's
+ * weight overestimates the key's true weight by at most its error, and any key
+ * heavier than the lightest entry is guaranteed to be in the summary. The
+ * other values are only what was added since the entry was last (re)used.
+ *
+ * Keys are copied, keeping the end of keys which don't fit.
+ */
+#define DATADOG_PHP_TOP_K_CAPACITY 64u
+#define DATADOG_PHP_TOP_K_KEY_CAPACITY 1022u
+
+typedef struct datadog_php_top_k_entry_s {
+  uint64_t hash;
+  int64_t weight;
+  int64_t error;
+  int64_t count;
+  int64_t wall_time;
+  int64_t cpu_time;
+  uint16_t key_len;
+  char key[DATADOG_PHP_TOP_K_KEY_CAPACITY];
+} datadog_php_top_k_entry;
+
+typedef struct datadog_php_top_k_s {
+  uint16_t len;
+  datadog_php_top_k_entry entries[DATADOG_PHP_TOP_K_CAPACITY];
+} datadog_php_top_k;
+
+void datadog_php_top_k_ctor(datadog_php_top_k *top);
+
+/**
+ * Forgets all keys, such as at the end of a profiling period.
+ */
+void datadog_php_top_k_clear(datadog_php_top_k *top);
+
+/**
+ * Adds `weight` and the values to `key`, evicting the lightest key if `key`
+ * isn't tracked and the summary is full.
+ */
+void datadog_php_top_k_add(datadog_php_top_k *top, datadog_php_string_view key,
+                           int64_t weight, int64_t count, int64_t wall_time,
+                           int64_t cpu_time);
+
+/**
+ * Stores pointers to the `n` heaviest entries into `entries`, heaviest first,
+ * and returns how many were stored, which is fewer if there aren't `n`.
+ */
+size_t datadog_php_top_k_heaviest(const datadog_php_top_k *top, size_t n,
+                                  const datadog_php_top_k_entry *entries[]);
+
+#endif // DATADOG_PHP_TOP_K_H
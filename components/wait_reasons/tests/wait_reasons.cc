@@ -0,0 +1,77 @@
+extern "C" {
+#include <components/wait_reasons/wait_reasons.h>
+}
+
+#include <catch2/catch.hpp>
+#include <string>
+
+static std::string find(const datadog_php_wait_reasons *reasons,
+                        const char *function) {
+  datadog_php_string_view reason = datadog_php_wait_reasons_find(
+      reasons, datadog_php_string_view_from_cstr(function));
+  return std::string(reason.ptr, reason.len);
+}
+
+TEST_CASE("default rules", "[wait_reasons]") {
+  datadog_php_wait_reasons reasons;
+  datadog_php_wait_reasons_default_ctor(&reasons);
+
+  CHECK(find(&reasons, "curl_exec") == "http");
+  CHECK(find(&reasons, "PDOStatement::execute") == "db");
+  CHECK(find(&reasons, "fread") == "file");
+  CHECK(find(&reasons, "usleep") == "sleep");
+  CHECK(find(&reasons, "strlen") == "");
+  CHECK(find(&reasons, "") == "");
+}
+
+TEST_CASE("names are case-insensitive", "[wait_reasons]") {
+  datadog_php_wait_reasons reasons;
+  datadog_php_wait_reasons_default_ctor(&reasons);
+
+  CHECK(find(&reasons, "CURL_EXEC") == "http");
+  CHECK(find(&reasons, "pdostatement::EXECUTE") == "db");
+}
+
+TEST_CASE("class wildcards", "[wait_reasons]") {
+  datadog_php_wait_reasons reasons;
+  datadog_php_wait_reasons_default_ctor(&reasons);
+
+  CHECK(find(&reasons, "Redis::get") == "cache");
+  CHECK(find(&reasons, "redis::hGetAll") == "cache");
+  CHECK(find(&reasons, "Redis::") == "");
+  CHECK(find(&reasons, "RedisCluster::get") == "");
+}
+
+TEST_CASE("parse adds rules which take precedence", "[wait_reasons]") {
+  datadog_php_wait_reasons reasons;
+  datadog_php_wait_reasons_default_ctor(&reasons);
+
+  const char *config = " Grpc\\Call::startBatch : rpc ,file_get_contents:http";
+  REQUIRE(datadog_php_wait_reasons_parse(
+      &reasons, datadog_php_string_view_from_cstr(config)));
+
+  CHECK(find(&reasons, "Grpc\\Call::startBatch") == "rpc");
+  CHECK(find(&reasons, "file_get_contents") == "http");
+  CHECK(find(&reasons, "fread") == "file");
+}
+
+TEST_CASE("parse skips malformed entries", "[wait_reasons]") {
+  datadog_php_wait_reasons reasons;
+  reasons.len = 0;
+
+  const char *config = "no_reason,:no_name,a:,ok:yes,,";
+  CHECK(!datadog_php_wait_reasons_parse(
+      &reasons, datadog_php_string_view_from_cstr(config)));
+
+  CHECK(reasons.len == 1);
+  CHECK(find(&reasons, "ok") == "yes");
+}
+
+TEST_CASE("parse stops adding when full", "[wait_reasons]") {
+  datadog_php_wait_reasons reasons;
+  reasons.len = DATADOG_PHP_WAIT_REASONS_CAPACITY;
+
+  CHECK(!datadog_php_wait_reasons_parse(
+      &reasons, datadog_php_string_view_from_cstr("a:b")));
+  CHECK(reasons.len == DATADOG_PHP_WAIT_REASONS_CAPACITY);
+}
@@ -0,0 +1,151 @@
+#include "wait_reasons.h"
+
+typedef datadog_php_string_view string_view_t;
+
+#define SV(cstr) DATADOG_PHP_STRING_VIEW_LITERAL(cstr)
+
+static const datadog_php_wait_reason_rule default_rules[] = {
+    {SV("sleep"), SV("sleep")},
+    {SV("usleep"), SV("sleep")},
+    {SV("time_nanosleep"), SV("sleep")},
+    {SV("time_sleep_until"), SV("sleep")},
+
+    {SV("curl_exec"), SV("http")},
+    {SV("curl_multi_exec"), SV("http")},
+    {SV("curl_multi_select"), SV("http")},
+
+    {SV("PDO::exec"), SV("db")},
+    {SV("PDO::query"), SV("db")},
+    {SV("PDO::prepare"), SV("db")},
+    {SV("PDOStatement::execute"), SV("db")},
+    {SV("PDOStatement::fetch"), SV("db")},
+    {SV("PDOStatement::fetchAll"), SV("db")},
+    {SV("mysqli_query"), SV("db")},
+    {SV("mysqli_real_query"), SV("db")},
+    {SV("mysqli_stmt_execute"), SV("db")},
+    {SV("mysqli::query"), SV("db")},
+    {SV("mysqli::real_query"), SV("db")},
+    {SV("mysqli_stmt::execute"), SV("db")},
+    {SV("pg_query"), SV("db")},
+    {SV("pg_query_params"), SV("db")},
+    {SV("pg_execute"), SV("db")},
+
+    {SV("Redis::*"), SV("cache")},
+    {SV("Memcached::*"), SV("cache")},
+
+    {SV("fread"), SV("file")},
+    {SV("fgets"), SV("file")},
+    {SV("fwrite"), SV("file")},
+    {SV("fopen"), SV("file")},
+    {SV("flock"), SV("file")},
+    {SV("file"), SV("file")},
+    {SV("file_get_contents"), SV("file")},
+    {SV("file_put_contents"), SV("file")},
+
+    {SV("fsockopen"), SV("network")},
+    {SV("stream_socket_client"), SV("network")},
+    {SV("stream_select"), SV("network")},
+    {SV("socket_read"), SV("network")},
+    {SV("socket_recv"), SV("network")},
+};
+
+static bool add_rule(datadog_php_wait_reasons *reasons, string_view_t function,
+                     string_view_t reason) {
+  if (reasons->len == DATADOG_PHP_WAIT_REASONS_CAPACITY) {
+    return false;
+  }
+  reasons->rules[reasons->len++] =
+      (datadog_php_wait_reason_rule){function, reason};
+  return true;
+}
+
+void datadog_php_wait_reasons_default_ctor(datadog_php_wait_reasons *reasons) {
+  reasons->len = 0;
+  unsigned n_rules = sizeof default_rules / sizeof *default_rules;
+  for (unsigned i = 0; i != n_rules; ++i) {
+    (void)add_rule(reasons, default_rules[i].function,
+                   default_rules[i].reason);
+  }
+}
+
+static bool is_space(char c) { return c == ' ' || c == '\t'; }
+
+static string_view_t trim(const char *begin, const char *end) {
+  while (begin != end && is_space(*begin)) {
+    ++begin;
+  }
+  while (end != begin && is_space(end[-1])) {
+    --end;
+  }
+  return (string_view_t){(size_t)(end - begin), begin};
+}
+
+bool datadog_php_wait_reasons_parse(datadog_php_wait_reasons *reasons,
+                                    string_view_t config) {
+  bool ok = true;
+  const char *ptr = config.ptr, *end = config.ptr + config.len;
+  while (ptr != end) {
+    const char *entry_end = ptr;
+    while (entry_end != end && *entry_end != ',') {
+      ++entry_end;
+    }
+
+    // The reason follows the last colon, as names may contain "::".
+    const char *colon = entry_end;
+    while (colon != ptr && colon[-1] != ':') {
+      --colon;
+    }
+
+    if (colon != ptr) {
+      string_view_t function = trim(ptr, colon - 1);
+      string_view_t reason = trim(colon, entry_end);
+      if (function.len && reason.len) {
+        ok = add_rule(reasons, function, reason) && ok;
+      } else {
+        ok = false;
+      }
+    } else if (trim(ptr, entry_end).len) {
+      ok = false;
+    }
+
+    ptr = entry_end == end ? end : entry_end + 1;
+  }
+  return ok;
+}
+
+static char ascii_lower(char c) {
+  return c >= 'A' && c <= 'Z' ? (char)(c - 'A' + 'a') : c;
+}
+
+static bool equal_ci(const char *a, const char *b, size_t len) {
+  for (size_t i = 0; i != len; ++i) {
+    if (ascii_lower(a[i]) != ascii_lower(b[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool rule_matches(string_view_t pattern, string_view_t function) {
+  if (pattern.len >= 3 && pattern.ptr[pattern.len - 1] == '*' &&
+      pattern.ptr[pattern.len - 2] == ':') {
+    // "Class::*" matches "Class::" followed by anything.
+    size_t prefix_len = pattern.len - 1;
+    return function.len > prefix_len &&
+           equal_ci(pattern.ptr, function.ptr, prefix_len);
+  }
+  return pattern.len == function.len &&
+         equal_ci(pattern.ptr, function.ptr, pattern.len);
+}
+
+string_view_t
+datadog_php_wait_reasons_find(const datadog_php_wait_reasons *reasons,
+                              string_view_t function) {
+  for (uint16_t i = reasons->len; i != 0; --i) {
+    const datadog_php_wait_reason_rule *rule = &reasons->rules[i - 1];
+    if (rule_matches(rule->function, function)) {
+      return rule->reason;
+    }
+  }
+  return (string_view_t)DATADOG_PHP_STRING_VIEW_INIT;
+}
@@ -0,0 +1,48 @@
+#ifndef DATADOG_PHP_WAIT_REASONS_H
+#define DATADOG_PHP_WAIT_REASONS_H
+
+#include <components/string_view/string_view.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Maps the names of internal functions which block, such as "curl_exec" or
+ * "PDOStatement::execute", to why they block, such as "http" or "db". Names
+ * are matched case-insensitively like PHP does, and "Class::*" matches every
+ * method of the class. Later rules take precedence over earlier ones.
+ *
+ * The table doesn't copy strings, so they need to outlive it.
+ */
+#define DATADOG_PHP_WAIT_REASONS_CAPACITY 128
+
+typedef struct datadog_php_wait_reason_rule_s {
+  datadog_php_string_view function;
+  datadog_php_string_view reason;
+} datadog_php_wait_reason_rule;
+
+typedef struct datadog_php_wait_reasons_s {
+  uint16_t len;
+  datadog_php_wait_reason_rule rules[DATADOG_PHP_WAIT_REASONS_CAPACITY];
+} datadog_php_wait_reasons;
+
+/**
+ * Initializes the table with the built-in rules for common extensions.
+ */
+void datadog_php_wait_reasons_default_ctor(datadog_php_wait_reasons *reasons);
+
+/**
+ * Adds the rules in `config`, which has the form "name:reason,name:reason".
+ * Whitespace around names and reasons is ignored. Malformed entries and ones
+ * which don't fit are skipped; returns false if there were any.
+ */
+bool datadog_php_wait_reasons_parse(datadog_php_wait_reasons *reasons,
+                                    datadog_php_string_view config);
+
+/**
+ * Returns the reason for `function`, or an empty string if it has none.
+ */
+datadog_php_string_view
+datadog_php_wait_reasons_find(const datadog_php_wait_reasons *reasons,
+                              datadog_php_string_view function);
+
+#endif // DATADOG_PHP_WAIT_REASONS_H
@@ -35,13 +35,169 @@ PHP_MINFO_FUNCTION(datadog_profiling) {
   datadog_profiling_diagnostics();
 }
 
+/* {{{ proto bool datadog_profiling_burst(int $seconds, int $interval_ms = 1)
+ * Samples this process at a higher frequency for the given number of seconds
+ * and uploads those samples as a separate profile once it's over. */
+PHP_FUNCTION(datadog_profiling_burst) {
+  zend_long seconds, interval_ms = 1;
+  if (zend_parse_parameters(ZEND_NUM_ARGS(), "l|l", &seconds, &interval_ms) ==
+      FAILURE) {
+    RETURN_FALSE;
+  }
+
+  if (seconds < 1 || seconds > 3600) {
+    zend_error(E_WARNING, "%s(): $seconds must be between 1 and 3600",
+               get_active_function_name());
+    RETURN_FALSE;
+  }
+  if (interval_ms < 1 || interval_ms > 1000) {
+    zend_error(E_WARNING, "%s(): $interval_ms must be between 1 and 1000",
+               get_active_function_name());
+    RETURN_FALSE;
+  }
+
+  RETURN_BOOL(
+      datadog_profiling_burst((uint32_t)seconds, (uint32_t)interval_ms));
+}
+/* }}} */
+
+/* {{{ proto bool datadog_profiling_set_label(string $key, string $value)
+ * Labels the samples of the rest of the current request, such as with a
+ * tenant id, so costs can be attributed to it. */
+PHP_FUNCTION(datadog_profiling_set_label) {
+  zend_string *key, *value;
+  if (zend_parse_parameters(ZEND_NUM_ARGS(), "SS", &key, &value) == FAILURE) {
+    RETURN_FALSE;
+  }
+
+  if (ZSTR_LEN(key) < 1 || ZSTR_LEN(key) > 255) {
+    zend_error(E_WARNING, "%s(): $key must be between 1 and 255 bytes long",
+               get_active_function_name());
+    RETURN_FALSE;
+  }
+  if (ZSTR_LEN(value) > 255) {
+    zend_error(E_WARNING, "%s(): $value must be at most 255 bytes long",
+               get_active_function_name());
+    RETURN_FALSE;
+  }
+
+  RETURN_BOOL(datadog_profiling_set_label(ZSTR_VAL(key), ZSTR_LEN(key),
+                                          ZSTR_VAL(value), ZSTR_LEN(value)));
+}
+/* }}} */
+
+/* {{{ proto bool datadog_profiling_clear_label(?string $key = null)
+ * Removes a label set by datadog_profiling_set_label, or all of them if no
+ * key is given. */
+PHP_FUNCTION(datadog_profiling_clear_label) {
+  zend_string *key = NULL;
+  if (zend_parse_parameters(ZEND_NUM_ARGS(), "|S!", &key) == FAILURE) {
+    RETURN_FALSE;
+  }
+
+  RETURN_BOOL(datadog_profiling_clear_label(key ? ZSTR_VAL(key) : NULL,
+                                            key ? ZSTR_LEN(key) : 0));
+}
+/* }}} */
+
+/* {{{ proto bool datadog_profiling_start_region(int $interval_ms = 0)
+ * Samples the current request every $interval_ms until the matching call to
+ * datadog_profiling_end_region, or at the usual interval if it's 0. */
+PHP_FUNCTION(datadog_profiling_start_region) {
+  zend_long interval_ms = 0;
+  if (zend_parse_parameters(ZEND_NUM_ARGS(), "|l", &interval_ms) == FAILURE) {
+    RETURN_FALSE;
+  }
+
+  if (interval_ms < 0 || interval_ms > 1000) {
+    zend_error(E_WARNING, "%s(): $interval_ms must be between 0 and 1000",
+               get_active_function_name());
+    RETURN_FALSE;
+  }
+
+  RETURN_BOOL(datadog_profiling_start_region((uint32_t)interval_ms));
+}
+/* }}} */
+
+/* {{{ proto bool datadog_profiling_end_region()
+ * Ends the region started by the last unmatched call to
+ * datadog_profiling_start_region. */
+PHP_FUNCTION(datadog_profiling_end_region) {
+  if (zend_parse_parameters_none() == FAILURE) {
+    RETURN_FALSE;
+  }
+
+  RETURN_BOOL(datadog_profiling_end_region());
+}
+/* }}} */
+
+/* {{{ proto array|false datadog_profiling_top(int $n = 10)
+ * Returns the heaviest leaf functions and stacks of the profile in progress,
+ * heaviest first, with their sample counts and wall and cpu time. */
+PHP_FUNCTION(datadog_profiling_top) {
+  zend_long n = 10;
+  if (zend_parse_parameters(ZEND_NUM_ARGS(), "|l", &n) == FAILURE) {
+    RETURN_FALSE;
+  }
+
+  if (n < 1 || n > 64) {
+    zend_error(E_WARNING, "%s(): $n must be between 1 and 64",
+               get_active_function_name());
+    RETURN_FALSE;
+  }
+
+  if (!datadog_profiling_top((uint32_t)n, return_value)) {
+    RETURN_FALSE;
+  }
+}
+/* }}} */
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_datadog_profiling_burst, 0, 0, 1)
+ZEND_ARG_INFO(0, seconds)
+ZEND_ARG_INFO(0, interval_ms)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_datadog_profiling_set_label, 0, 0, 2)
+ZEND_ARG_INFO(0, key)
+ZEND_ARG_INFO(0, value)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_datadog_profiling_clear_label, 0, 0, 0)
+ZEND_ARG_INFO(0, key)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_datadog_profiling_start_region, 0, 0, 0)
+ZEND_ARG_INFO(0, interval_ms)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_datadog_profiling_end_region, 0, 0, 0)
+ZEND_END_ARG_INFO()
+
+ZEND_BEGIN_ARG_INFO_EX(arginfo_datadog_profiling_top, 0, 0, 0)
+ZEND_ARG_INFO(0, n)
+ZEND_END_ARG_INFO()
+
+// clang-format off
+static const zend_function_entry datadog_profiling_functions[] = {
+    PHP_FE(datadog_profiling_burst, arginfo_datadog_profiling_burst)
+    PHP_FE(datadog_profiling_set_label, arginfo_datadog_profiling_set_label)
+    PHP_FE(datadog_profiling_clear_label,
+           arginfo_datadog_profiling_clear_label)
+    PHP_FE(datadog_profiling_start_region,
+           arginfo_datadog_profiling_start_region)
+    PHP_FE(datadog_profiling_end_region, arginfo_datadog_profiling_end_region)
+    PHP_FE(datadog_profiling_top, arginfo_datadog_profiling_top)
+    PHP_FE_END
+};
+// clang-format on
+
 /* Make this a hybrid zendextension-module, which gives us access to the minfo
  * hook, so we can print diagnostics.
  */
 static zend_module_entry datadog_profiling_module_entry = {
     STANDARD_MODULE_HEADER,
     "datadog-profiling",
-    NULL,
+    datadog_profiling_functions,
     NULL,
     NULL,
     NULL,
@@ -6,7 +6,29 @@ void datadog_php_profiling_config_default_ctor(
     datadog_php_profiling_config *config) {
   datadog_php_profiling_config tmp = {
       .profiling_enabled = false,
+      .profiling_diagnostics_upload_enabled = false,
       .profiling_experimental_cpu_enabled = false,
+      .profiling_experimental_exception_enabled = false,
+      .profiling_experimental_gc_enabled = false,
+      .profiling_experimental_compile_time_enabled = false,
+      .profiling_experimental_split_samples_enabled = false,
+      .profiling_experimental_remote_sampling_enabled = false,
+      .profiling_experimental_kept_trace_boost_enabled = false,
+      .profiling_experimental_wait_reason_enabled = false,
+      .profiling_experimental_native_frames_enabled = false,
+      .profiling_experimental_line_hotspots_enabled = false,
+      .profiling_experimental_timeline_enabled = false,
+      .profiling_experimental_memory_enabled = false,
+      .profiling_experimental_request_phases_enabled = false,
+      .profiling_experimental_regions_only = false,
+      .profiling_experimental_top_enabled = false,
+      .profiling_experimental_wait_reasons = DDPROF_FFI_CHARSLICE_C(""),
+      .profiling_fiber_stitching_enabled = true,
+      .profiling_exception_sampling_distance = 100,
+      .profiling_experimental_slow_request_threshold_ms = 0,
+      .profiling_experimental_burst_signal = 0,
+      .profiling_request_sample_rate = 1000000,
+      .profiling_worker_sample_rate = 1000000,
       .profiling_log_level = DATADOG_PHP_LOG_OFF,
       .endpoint = ddprof_ffi_EndpointV3_agent(
           DDPROF_FFI_CHARSLICE_C("http://localhost:8126")),
@@ -82,6 +104,63 @@ static bool is_boolean_true(ddprof_ffi_CharSlice str) {
   }
 }
 
+/**
+ * Parses `str` as a base-10 unsigned integer. Returns `default_value` if `str`
+ * is empty, has anything other than digits, or is outside of [min, max].
+ */
+static uint32_t parse_u32(ddprof_ffi_CharSlice str, uint32_t default_value,
+                          uint32_t min, uint32_t max) {
+  // UINT32_MAX has 10 digits
+  if (str.len == 0 || str.len > 10) {
+    return default_value;
+  }
+
+  uint64_t value = 0;
+  for (size_t i = 0; i != str.len; ++i) {
+    char c = str.ptr[i];
+    if (c < '0' || c > '9') {
+      return default_value;
+    }
+    value = value * 10 + (uint64_t)(c - '0');
+  }
+
+  return value >= min && value <= max ? (uint32_t)value : default_value;
+}
+
+/**
+ * Parses `str` as a rate between 0 and 1 such as "0.25", and returns it in
+ * parts per million; digits past the 6th decimal place are ignored. Returns
+ * `default_value` if `str` is empty, malformed, or greater than 1.
+ */
+static uint32_t parse_rate_ppm(ddprof_ffi_CharSlice str,
+                               uint32_t default_value) {
+  if (str.len == 0 || str.ptr[0] < '0' || str.ptr[0] > '1') {
+    return default_value;
+  }
+
+  uint32_t whole = (uint32_t)(str.ptr[0] - '0');
+  uint32_t fraction = 0, scale = 100000;
+  size_t i = 1;
+  if (i != str.len) {
+    if (str.ptr[i++] != '.' || i == str.len) {
+      return default_value;
+    }
+    for (; i != str.len; ++i) {
+      char c = str.ptr[i];
+      if (c < '0' || c > '9') {
+        return default_value;
+      }
+      fraction += (uint32_t)(c - '0') * scale;
+      scale /= 10;
+    }
+  }
+
+  if (whole == 1 && fraction) {
+    return default_value;
+  }
+  return whole * 1000000 + fraction;
+}
+
 static ddprof_ffi_CharSlice charslice_from_cstr(const char *str) {
   return (ddprof_ffi_CharSlice){str, strlen(str)};
 }
@@ -90,8 +169,60 @@ void datadog_php_profiling_config_ctor(datadog_php_profiling_config *config,
                                        datadog_php_arena *arena,
                                        const datadog_php_profiling_env *env) {
   config->profiling_enabled = is_boolean_true(env->profiling_enabled);
+  config->profiling_diagnostics_upload_enabled =
+      is_boolean_true(env->profiling_diagnostics_upload_enabled);
   config->profiling_experimental_cpu_enabled =
       is_boolean_true(env->profiling_experimental_cpu_enabled);
+  config->profiling_experimental_exception_enabled =
+      is_boolean_true(env->profiling_experimental_exception_enabled);
+  config->profiling_experimental_gc_enabled =
+      is_boolean_true(env->profiling_experimental_gc_enabled);
+  config->profiling_experimental_compile_time_enabled =
+      is_boolean_true(env->profiling_experimental_compile_time_enabled);
+  config->profiling_experimental_split_samples_enabled =
+      is_boolean_true(env->profiling_experimental_split_samples_enabled);
+  config->profiling_experimental_remote_sampling_enabled =
+      is_boolean_true(env->profiling_experimental_remote_sampling_enabled);
+  config->profiling_experimental_kept_trace_boost_enabled =
+      is_boolean_true(env->profiling_experimental_kept_trace_boost_enabled);
+  config->profiling_experimental_wait_reason_enabled =
+      is_boolean_true(env->profiling_experimental_wait_reason_enabled);
+  config->profiling_experimental_wait_reasons =
+      env->profiling_experimental_wait_reasons;
+  config->profiling_experimental_native_frames_enabled =
+      is_boolean_true(env->profiling_experimental_native_frames_enabled);
+  config->profiling_experimental_line_hotspots_enabled =
+      is_boolean_true(env->profiling_experimental_line_hotspots_enabled);
+  config->profiling_experimental_timeline_enabled =
+      is_boolean_true(env->profiling_experimental_timeline_enabled);
+  config->profiling_experimental_memory_enabled =
+      is_boolean_true(env->profiling_experimental_memory_enabled);
+  config->profiling_experimental_request_phases_enabled =
+      is_boolean_true(env->profiling_experimental_request_phases_enabled);
+  config->profiling_experimental_regions_only =
+      is_boolean_true(env->profiling_experimental_regions_only);
+  config->profiling_experimental_top_enabled =
+      is_boolean_true(env->profiling_experimental_top_enabled);
+  // This one defaults to true, so only override it when it's set.
+  if (env->profiling_fiber_stitching_enabled.len) {
+    config->profiling_fiber_stitching_enabled =
+        is_boolean_true(env->profiling_fiber_stitching_enabled);
+  }
+  config->profiling_exception_sampling_distance =
+      parse_u32(env->profiling_exception_sampling_distance,
+                config->profiling_exception_sampling_distance, 1, UINT32_MAX);
+  config->profiling_experimental_slow_request_threshold_ms =
+      parse_u32(env->profiling_experimental_slow_request_threshold_ms,
+                config->profiling_experimental_slow_request_threshold_ms, 0,
+                UINT32_MAX);
+  config->profiling_request_sample_rate = parse_rate_ppm(
+      env->profiling_request_sample_rate, config->profiling_request_sample_rate);
+  config->profiling_worker_sample_rate = parse_rate_ppm(
+      env->profiling_worker_sample_rate, config->profiling_worker_sample_rate);
+  // Signal numbers are small; 64 covers the real-time signals on Linux.
+  config->profiling_experimental_burst_signal =
+      parse_u32(env->profiling_experimental_burst_signal,
+                config->profiling_experimental_burst_signal, 0, 64);
 
   config->profiling_log_level =
       datadog_php_log_level_detect(sv_from_charslice(env->profiling_log_level));
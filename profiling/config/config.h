@@ -7,10 +7,33 @@
 #include <ddprof/ffi.h>
 #include <profiling/env/env.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 typedef struct datadog_php_profiling_config_s {
   bool profiling_enabled;
+  bool profiling_diagnostics_upload_enabled;
   bool profiling_experimental_cpu_enabled;
+  bool profiling_experimental_exception_enabled;
+  bool profiling_experimental_gc_enabled;
+  bool profiling_experimental_compile_time_enabled;
+  bool profiling_experimental_split_samples_enabled;
+  bool profiling_experimental_remote_sampling_enabled;
+  bool profiling_experimental_kept_trace_boost_enabled;
+  bool profiling_experimental_wait_reason_enabled;
+  bool profiling_experimental_native_frames_enabled;
+  bool profiling_experimental_line_hotspots_enabled;
+  bool profiling_experimental_timeline_enabled;
+  bool profiling_experimental_memory_enabled;
+  bool profiling_experimental_request_phases_enabled;
+  bool profiling_experimental_regions_only;
+  bool profiling_experimental_top_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_wait_reasons; // "name:reason,.."
+  bool profiling_fiber_stitching_enabled;
+  uint32_t profiling_exception_sampling_distance;
+  uint32_t profiling_experimental_slow_request_threshold_ms;
+  uint32_t profiling_experimental_burst_signal;
+  uint32_t profiling_request_sample_rate; // parts per million
+  uint32_t profiling_worker_sample_rate;  // parts per million
   datadog_php_log_level profiling_log_level;
   ddprof_ffi_EndpointV3 endpoint;
   ddprof_ffi_CharSlice env;
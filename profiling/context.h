@@ -1,6 +1,7 @@
 #ifndef DATADOG_PROFILING_CONTEXT_H
 #define DATADOG_PROFILING_CONTEXT_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 // Keep in sync with tracer's version (but they are different).
@@ -19,4 +20,31 @@ typedef struct ddtrace_profiling_context ddtrace_profiling_context;
 extern ddtrace_profiling_context (*datadog_profiling_get_profiling_context)(
     void);
 
+/* This is separate from the context rather than a new member of it, because
+ * changing the context would break the ABI with existing tracer versions.
+ */
+struct ddtrace_profiling_endpoint {
+  const char *ptr;
+  size_t len;
+};
+typedef struct ddtrace_profiling_endpoint ddtrace_profiling_endpoint;
+
+/**
+ * Provide the resource of the active trace's root span, such as
+ * "GET /users/{id}", which is what identifies the endpoint. If there isn't an
+ * active trace, or it doesn't have a resource yet, return an empty string. The
+ * string only needs to stay valid until the PHP thread runs more code, so the
+ * profiler copies it. Same thread requirements as the context.
+ */
+extern ddtrace_profiling_endpoint (*datadog_profiling_get_profiling_endpoint)(
+    void);
+
+/**
+ * Provide the sampling priority of the active trace, such as 1 for auto keep
+ * or 2 for user keep. If there isn't an active trace, or no sampling decision
+ * has been made yet, return 0. This is separate from the context for the same
+ * reason as the endpoint. Same thread requirements as the context.
+ */
+extern int64_t (*datadog_profiling_get_sampling_priority)(void);
+
 #endif // DATADOG_PROFILING_CONTEXT_H
@@ -20,6 +20,9 @@
 #include "context.h"
 #include "env/env.h"
 #include "once/once.h"
+#include "plugins/compile_plugin/compile_plugin.h"
+#include "plugins/exception_plugin/exception_plugin.h"
+#include "plugins/gc_plugin/gc_plugin.h"
 #include "plugins/log_plugin/log_plugin.h"
 #include "plugins/recorder_plugin/recorder_plugin.h"
 #include "plugins/stack_collector_plugin/stack_collector_plugin.h"
@@ -91,9 +94,85 @@ datadog_php_config_diagnose(const datadog_php_profiling_config *config) {
                                          PHP_DATADOG_PROFILING_VERSION);
   datadog_profiling_info_diagnostics_row("Profiling Enabled",
                                          config->profiling_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Diagnostics Upload Enabled",
+      config->profiling_diagnostics_upload_enabled ? yes : no);
   datadog_profiling_info_diagnostics_row(
       "Experimental CPU Profiling Enabled",
       config->profiling_experimental_cpu_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Exception Profiling Enabled",
+      config->profiling_experimental_exception_enabled ? yes : no);
+
+  char distance[16];
+  (void)snprintf(distance, sizeof distance, "%" PRIu32,
+                 config->profiling_exception_sampling_distance);
+  datadog_profiling_info_diagnostics_row("Exception Sampling Distance",
+                                         distance);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental GC Profiling Enabled",
+      config->profiling_experimental_gc_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Compile Time Profiling Enabled",
+      config->profiling_experimental_compile_time_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Split Samples Enabled",
+      config->profiling_experimental_split_samples_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Remote Sampling Enabled",
+      config->profiling_experimental_remote_sampling_enabled ? yes : no);
+
+  char threshold[16];
+  (void)snprintf(threshold, sizeof threshold, "%" PRIu32,
+                 config->profiling_experimental_slow_request_threshold_ms);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Slow Request Threshold (ms)", threshold);
+
+  char burst_signal[16] = "(disabled)";
+  if (config->profiling_experimental_burst_signal) {
+    (void)snprintf(burst_signal, sizeof burst_signal, "%" PRIu32,
+                   config->profiling_experimental_burst_signal);
+  }
+  datadog_profiling_info_diagnostics_row("Experimental Burst Signal",
+                                         burst_signal);
+
+  char request_rate[16], worker_rate[16];
+  (void)snprintf(request_rate, sizeof request_rate, "%g",
+                 config->profiling_request_sample_rate / 1e6);
+  (void)snprintf(worker_rate, sizeof worker_rate, "%g",
+                 config->profiling_worker_sample_rate / 1e6);
+  datadog_profiling_info_diagnostics_row("Request Sample Rate", request_rate);
+  datadog_profiling_info_diagnostics_row("Worker Sample Rate", worker_rate);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Kept Trace Boost Enabled",
+      config->profiling_experimental_kept_trace_boost_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Wait Reason Enabled",
+      config->profiling_experimental_wait_reason_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Native Frames Enabled",
+      config->profiling_experimental_native_frames_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Line Hotspots Enabled",
+      config->profiling_experimental_line_hotspots_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Timeline Enabled",
+      config->profiling_experimental_timeline_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Memory Enabled",
+      config->profiling_experimental_memory_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Request Phases Enabled",
+      config->profiling_experimental_request_phases_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Regions Only",
+      config->profiling_experimental_regions_only ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Experimental Top Enabled",
+      config->profiling_experimental_top_enabled ? yes : no);
+  datadog_profiling_info_diagnostics_row(
+      "Fiber Stitching Enabled",
+      config->profiling_fiber_stitching_enabled ? yes : no);
 
   datadog_profiling_info_diagnostics_row(
       "Profiling Log Level",
@@ -182,6 +261,19 @@ void datadog_profiling_find_ddtrace_symbols(void *arg) {
     if (EXPECTED(get_profiling)) {
       datadog_profiling_get_profiling_context = get_profiling;
     }
+
+    // Older tracers don't have this, so it's fine if it's missing.
+    struct ddtrace_profiling_endpoint (*get_endpoint)(void) =
+        DL_FETCH_SYMBOL(handle, "ddtrace_get_profiling_endpoint");
+    if (get_endpoint) {
+      datadog_profiling_get_profiling_endpoint = get_endpoint;
+    }
+
+    int64_t (*get_sampling_priority)(void) =
+        DL_FETCH_SYMBOL(handle, "ddtrace_get_profiling_sampling_priority");
+    if (get_sampling_priority) {
+      datadog_profiling_get_sampling_priority = get_sampling_priority;
+    }
   }
 }
 
@@ -205,6 +297,9 @@ zend_result datadog_profiling_startup(zend_extension *extension) {
   zend_llist_apply(&zend_extensions, datadog_profiling_find_ddtrace_symbols);
 
   datadog_php_stack_collector_startup(extension);
+  datadog_php_exception_plugin_startup(extension);
+  datadog_php_gc_plugin_startup(extension);
+  datadog_php_compile_plugin_startup(extension);
 
   return SUCCESS;
 }
@@ -318,6 +413,9 @@ static void datadog_profiling_first_activate(void) {
 
   datadog_php_recorder_plugin_first_activate(&profiling_config);
   datadog_php_stack_collector_first_activate(&profiling_config);
+  datadog_php_exception_plugin_first_activate(&profiling_config);
+  datadog_php_gc_plugin_first_activate(&profiling_config);
+  datadog_php_compile_plugin_first_activate(&profiling_config);
 }
 
 void datadog_profiling_activate(void) {
@@ -327,10 +425,95 @@ void datadog_profiling_activate(void) {
 
 void datadog_profiling_deactivate(void) {
   datadog_php_stack_collector_deactivate();
+  datadog_php_recorder_plugin_deactivate();
+}
+
+bool datadog_profiling_burst(uint32_t seconds, uint32_t interval_ms) {
+  return datadog_php_recorder_plugin_burst(seconds, interval_ms);
+}
+
+bool datadog_profiling_set_label(const char *key, size_t key_len,
+                                 const char *value, size_t value_len) {
+  string_view_t key_view = {key_len, key};
+  string_view_t value_view = {value_len, value};
+  switch (datadog_php_recorder_plugin_set_label(key_view, value_view)) {
+  case DATADOG_PHP_SET_LABEL_OK:
+    return true;
+  case DATADOG_PHP_SET_LABEL_DISABLED:
+    break;
+  case DATADOG_PHP_SET_LABEL_RESERVED:
+    zend_error(E_WARNING, "%s(): the profiler sets the '%.*s' label itself",
+               get_active_function_name(), (int)key_len, key);
+    break;
+  case DATADOG_PHP_SET_LABEL_TOO_MANY_LABELS:
+    zend_error(E_WARNING,
+               "%s(): cannot set the '%.*s' label, as a request can have at "
+               "most %u labels",
+               get_active_function_name(), (int)key_len, key,
+               DATADOG_PHP_LABEL_SET_CAPACITY);
+    break;
+  case DATADOG_PHP_SET_LABEL_TOO_MANY_SETS:
+    zend_error(E_WARNING,
+               "%s(): cannot set the '%.*s' label, as this process has too "
+               "many distinct combinations of labels",
+               get_active_function_name(), (int)key_len, key);
+    break;
+  }
+  return false;
+}
+
+bool datadog_profiling_clear_label(const char *key, size_t key_len) {
+  string_view_t key_view = {key_len, key_len ? key : ""};
+  return datadog_php_recorder_plugin_clear_label(key_view);
+}
+
+bool datadog_profiling_start_region(uint32_t interval_ms) {
+  return datadog_php_stack_collector_start_region(interval_ms);
+}
+
+bool datadog_profiling_end_region(void) {
+  return datadog_php_stack_collector_end_region();
+}
+
+static void top_to_array(zval *result, const char *name, const char *key_name,
+                         const datadog_php_top_k *top, uint32_t n) {
+  const datadog_php_top_k_entry *entries[DATADOG_PHP_TOP_K_CAPACITY];
+  size_t len = datadog_php_top_k_heaviest(
+      top, n < DATADOG_PHP_TOP_K_CAPACITY ? n : DATADOG_PHP_TOP_K_CAPACITY,
+      entries);
+
+  zval list;
+  array_init_size(&list, (uint32_t)len);
+  for (size_t i = 0; i != len; ++i) {
+    const datadog_php_top_k_entry *entry = entries[i];
+    zval item;
+    array_init_size(&item, 4);
+    add_assoc_stringl(&item, key_name, entry->key, entry->key_len);
+    add_assoc_long(&item, "samples", (zend_long)entry->count);
+    add_assoc_long(&item, "wall_time_ns", (zend_long)entry->wall_time);
+    add_assoc_long(&item, "cpu_time_ns", (zend_long)entry->cpu_time);
+    add_next_index_zval(&list, &item);
+  }
+  add_assoc_zval(result, name, &list);
+}
+
+bool datadog_profiling_top(uint32_t n, zval *result) {
+  datadog_php_top_k *functions = emalloc(sizeof *functions);
+  datadog_php_top_k *stacks = emalloc(sizeof *stacks);
+  bool success = datadog_php_recorder_plugin_top(functions, stacks);
+  if (success) {
+    array_init_size(result, 2);
+    top_to_array(result, "functions", "function", functions, n);
+    top_to_array(result, "stacks", "stack", stacks, n);
+  }
+  efree(stacks);
+  efree(functions);
+  return success;
 }
 
 void datadog_profiling_shutdown(zend_extension *extension) {
   datadog_php_once_dtor(&first_activate_once);
+  datadog_php_stack_collector_shutdown(extension);
   datadog_php_recorder_plugin_shutdown(extension);
   datadog_php_log_plugin_shutdown(extension);
 }
@@ -367,6 +550,10 @@ ZEND_API datadog_php_uuid datadog_profiling_runtime_id(void) {
   return runtime_id;
 }
 
+ZEND_API int64_t datadog_profiling_get_span_cpu_time(uint64_t span_id) {
+  return datadog_php_stack_collector_take_span_cpu_time(span_id);
+}
+
 static struct ddtrace_profiling_context
 datadog_profiling_get_profiling_context_null(void) {
   return (struct ddtrace_profiling_context){0, 0};
@@ -375,3 +562,16 @@ datadog_profiling_get_profiling_context_null(void) {
 // Default to null implementation to cut down on the number of edges of caller.
 struct ddtrace_profiling_context (*datadog_profiling_get_profiling_context)(
     void) = &datadog_profiling_get_profiling_context_null;
+
+static struct ddtrace_profiling_endpoint
+datadog_profiling_get_profiling_endpoint_null(void) {
+  return (struct ddtrace_profiling_endpoint){"", 0};
+}
+
+struct ddtrace_profiling_endpoint (*datadog_profiling_get_profiling_endpoint)(
+    void) = &datadog_profiling_get_profiling_endpoint_null;
+
+static int64_t datadog_profiling_get_sampling_priority_null(void) { return 0; }
+
+int64_t (*datadog_profiling_get_sampling_priority)(void) =
+    &datadog_profiling_get_sampling_priority_null;
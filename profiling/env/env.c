@@ -86,8 +86,51 @@ datadog_php_profiling_getenvs(datadog_php_profiling_env *env,
   } envs[] = {
       {"DD_AGENT_HOST", &env->agent_host},
       {"DD_ENV", &env->env},
+      {"DD_PROFILING_DIAGNOSTICS_UPLOAD_ENABLED",
+       &env->profiling_diagnostics_upload_enabled},
       {"DD_PROFILING_ENABLED", &env->profiling_enabled},
+      {"DD_PROFILING_EXCEPTION_SAMPLING_DISTANCE",
+       &env->profiling_exception_sampling_distance},
+      {"DD_PROFILING_EXPERIMENTAL_BURST_SIGNAL",
+       &env->profiling_experimental_burst_signal},
+      {"DD_PROFILING_EXPERIMENTAL_COMPILE_TIME_ENABLED",
+       &env->profiling_experimental_compile_time_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_EXCEPTION_ENABLED",
+       &env->profiling_experimental_exception_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_GC_ENABLED",
+       &env->profiling_experimental_gc_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_KEPT_TRACE_BOOST_ENABLED",
+       &env->profiling_experimental_kept_trace_boost_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_LINE_HOTSPOTS_ENABLED",
+       &env->profiling_experimental_line_hotspots_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_MEMORY_ENABLED",
+       &env->profiling_experimental_memory_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_NATIVE_FRAMES_ENABLED",
+       &env->profiling_experimental_native_frames_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_REGIONS_ONLY",
+       &env->profiling_experimental_regions_only},
+      {"DD_PROFILING_EXPERIMENTAL_REMOTE_SAMPLING_ENABLED",
+       &env->profiling_experimental_remote_sampling_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_REQUEST_PHASES_ENABLED",
+       &env->profiling_experimental_request_phases_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_SLOW_REQUEST_THRESHOLD_MS",
+       &env->profiling_experimental_slow_request_threshold_ms},
+      {"DD_PROFILING_EXPERIMENTAL_SPLIT_SAMPLES_ENABLED",
+       &env->profiling_experimental_split_samples_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_TIMELINE_ENABLED",
+       &env->profiling_experimental_timeline_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_TOP_ENABLED",
+       &env->profiling_experimental_top_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_WAIT_REASON_ENABLED",
+       &env->profiling_experimental_wait_reason_enabled},
+      {"DD_PROFILING_EXPERIMENTAL_WAIT_REASONS",
+       &env->profiling_experimental_wait_reasons},
+      {"DD_PROFILING_FIBER_STITCHING_ENABLED",
+       &env->profiling_fiber_stitching_enabled},
       {"DD_PROFILING_LOG_LEVEL", &env->profiling_log_level},
+      {"DD_PROFILING_REQUEST_SAMPLE_RATE",
+       &env->profiling_request_sample_rate},
+      {"DD_PROFILING_WORKER_SAMPLE_RATE", &env->profiling_worker_sample_rate},
       {"DD_SERVICE", &env->service},
       {"DD_TAGS", &env->tags},
       {"DD_TRACE_AGENT_PORT", &env->trace_agent_port},
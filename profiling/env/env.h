@@ -9,9 +9,31 @@
 typedef struct datadog_php_profiling_env_s {
   ddprof_ffi_CharSlice agent_host;
   ddprof_ffi_CharSlice env;
+  ddprof_ffi_CharSlice profiling_diagnostics_upload_enabled;
   ddprof_ffi_CharSlice profiling_enabled;
+  ddprof_ffi_CharSlice profiling_exception_sampling_distance;
+  ddprof_ffi_CharSlice profiling_experimental_burst_signal;
+  ddprof_ffi_CharSlice profiling_experimental_compile_time_enabled;
   ddprof_ffi_CharSlice profiling_experimental_cpu_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_exception_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_gc_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_kept_trace_boost_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_line_hotspots_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_memory_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_native_frames_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_regions_only;
+  ddprof_ffi_CharSlice profiling_experimental_remote_sampling_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_request_phases_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_slow_request_threshold_ms;
+  ddprof_ffi_CharSlice profiling_experimental_split_samples_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_timeline_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_top_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_wait_reason_enabled;
+  ddprof_ffi_CharSlice profiling_experimental_wait_reasons;
+  ddprof_ffi_CharSlice profiling_fiber_stitching_enabled;
   ddprof_ffi_CharSlice profiling_log_level;
+  ddprof_ffi_CharSlice profiling_request_sample_rate;
+  ddprof_ffi_CharSlice profiling_worker_sample_rate;
   ddprof_ffi_CharSlice service;
   ddprof_ffi_CharSlice tags;
   ddprof_ffi_CharSlice trace_agent_port;
@@ -24,9 +46,31 @@ datadog_php_profiling_env_default_ctor(datadog_php_profiling_env *env) {
   ddprof_ffi_CharSlice empty = DDPROF_FFI_CHARSLICE_C("");
   env->agent_host = empty;
   env->env = empty;
+  env->profiling_diagnostics_upload_enabled = empty;
   env->profiling_enabled = empty;
+  env->profiling_exception_sampling_distance = empty;
+  env->profiling_experimental_burst_signal = empty;
+  env->profiling_experimental_compile_time_enabled = empty;
   env->profiling_experimental_cpu_enabled = empty;
+  env->profiling_experimental_exception_enabled = empty;
+  env->profiling_experimental_gc_enabled = empty;
+  env->profiling_experimental_kept_trace_boost_enabled = empty;
+  env->profiling_experimental_native_frames_enabled = empty;
+  env->profiling_experimental_line_hotspots_enabled = empty;
+  env->profiling_experimental_timeline_enabled = empty;
+  env->profiling_experimental_top_enabled = empty;
+  env->profiling_experimental_memory_enabled = empty;
+  env->profiling_experimental_request_phases_enabled = empty;
+  env->profiling_experimental_regions_only = empty;
+  env->profiling_experimental_remote_sampling_enabled = empty;
+  env->profiling_experimental_slow_request_threshold_ms = empty;
+  env->profiling_experimental_split_samples_enabled = empty;
+  env->profiling_experimental_wait_reason_enabled = empty;
+  env->profiling_experimental_wait_reasons = empty;
+  env->profiling_fiber_stitching_enabled = empty;
   env->profiling_log_level = empty;
+  env->profiling_request_sample_rate = empty;
+  env->profiling_worker_sample_rate = empty;
   env->service = empty;
   env->tags = empty;
   env->trace_agent_port = empty;
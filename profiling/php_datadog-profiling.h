@@ -6,6 +6,8 @@
 #include <Zend/zend_extensions.h>
 #include <Zend/zend_portability.h>
 #include <components/uuid/uuid.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 // C11 allows a typedef to be declared multiple times as long as it denotes the
 // same type as it currently does.
@@ -19,9 +21,55 @@ void datadog_profiling_deactivate(void);
 void datadog_profiling_shutdown(zend_extension *);
 void datadog_profiling_diagnostics(void);
 
+/**
+ * Starts a burst of high-frequency sampling. The interval is in milliseconds,
+ * as that's the resolution of the collector's timer. Returns false if
+ * profiling isn't enabled.
+ */
+bool datadog_profiling_burst(uint32_t seconds, uint32_t interval_ms);
+
+/**
+ * Sets the custom label `key` to `value` on this thread's samples until the
+ * end of the request. Warns and returns false if it can't be set, except when
+ * profiling isn't enabled, where it only returns false.
+ */
+bool datadog_profiling_set_label(const char *key, size_t key_len,
+                                 const char *value, size_t value_len);
+
+/**
+ * Removes the custom label `key`, or all of them if `key_len` is 0. Returns
+ * false if profiling isn't enabled.
+ */
+bool datadog_profiling_clear_label(const char *key, size_t key_len);
+
+/**
+ * Starts a profiling region on this thread, sampled every `interval_ms` if
+ * that's more often than usual, or at the usual interval if it's 0. Returns
+ * false if this request isn't being profiled.
+ */
+bool datadog_profiling_start_region(uint32_t interval_ms);
+
+/**
+ * Ends the innermost profiling region on this thread. Returns false if there
+ * isn't one or this request isn't being profiled.
+ */
+bool datadog_profiling_end_region(void);
+
+/**
+ * Sets `result` to an array of the `n` heaviest leaf functions and stacks of
+ * the profile in progress, at most 64 of each. Returns false, leaving `result`
+ * untouched, if profiling or the top isn't enabled.
+ */
+bool datadog_profiling_top(uint32_t n, zval *result);
+
 BEGIN_EXTERN_C()
 ZEND_API void datadog_profiling_interrupt_function(struct _zend_execute_data *);
 ZEND_API datadog_php_uuid datadog_profiling_runtime_id(void);
+
+/* The tracer calls this when a span closes, on the thread which ran it, to
+ * attach the span's own cpu time in nanoseconds. Each span can be read once.
+ */
+ZEND_API int64_t datadog_profiling_get_span_cpu_time(uint64_t span_id);
 END_EXTERN_C()
 
 #if defined(ZTS)
@@ -0,0 +1,139 @@
+#include "compile_plugin.h"
+
+#include "../../context.h"
+#include "../recorder_plugin/recorder_plugin.h"
+#include "../stack_collector_plugin/stack_collector_plugin.h"
+#include <components/clocks/clocks.h>
+#include <stack-collector/stack-collector.h>
+
+#include <Zend/zend_compile.h>
+#include <php.h>
+#include <stdatomic.h>
+#include <uv.h>
+
+#if PHP_VERSION_ID >= 80000
+typedef zend_string compile_string_source_t;
+typedef const char compile_string_filename_t;
+#else
+typedef zval compile_string_source_t;
+typedef char compile_string_filename_t;
+#endif
+
+static zend_op_array *(*prev_compile_file)(zend_file_handle *, int);
+static zend_op_array *(*prev_compile_string)(compile_string_source_t *,
+                                             compile_string_filename_t *);
+static _Atomic bool enabled;
+
+static _Thread_local datadog_php_stack_sample compile_sample; // this is big!
+
+typedef struct compile_timer_s {
+  uint64_t wall_before;
+  datadog_php_cpu_time_result cpu_before;
+} compile_timer;
+
+static compile_timer compile_timer_start(void) {
+  compile_timer timer = {.cpu_before = {.tag = DATADOG_PHP_CPU_TIME_ERR}};
+  if (datadog_php_profiling_cpu_time_enabled) {
+    timer.cpu_before = datadog_php_cpu_time_now();
+  }
+  timer.wall_before = uv_hrtime();
+  return timer;
+}
+
+static void compile_timer_record(compile_timer timer, const char *filename) {
+  uint64_t wall_after = uv_hrtime();
+  datadog_php_record_values values = {
+      .wall_time = (int64_t)(wall_after - timer.wall_before),
+  };
+
+  if (timer.cpu_before.tag == DATADOG_PHP_CPU_TIME_OK) {
+    datadog_php_cpu_time_result cpu_after = datadog_php_cpu_time_now();
+    if (cpu_after.tag == DATADOG_PHP_CPU_TIME_OK) {
+      struct timespec then = timer.cpu_before.ok, now = cpu_after.ok;
+      int64_t current = now.tv_sec * INT64_C(1000000000) + now.tv_nsec;
+      int64_t prev = then.tv_sec * INT64_C(1000000000) + then.tv_nsec;
+      values.cpu_time = current - prev;
+    }
+  }
+
+  values.count = datadog_php_stack_collector_exclude_time(values.wall_time,
+                                                         values.cpu_time);
+  datadog_php_stack_collector_weight(&values);
+
+  /* The file being compiled goes into the frame's file rather than its name
+   * so that the compile time of all files rolls up into a single [compile]
+   * function, while the file is still available per location.
+   */
+  datadog_php_stack_sample_frame frame = {
+      .function = DATADOG_PHP_STRING_VIEW_LITERAL("[compile]"),
+      .file = datadog_php_string_view_from_cstr(filename),
+      .lineno = 0,
+  };
+  datadog_php_stack_collect_synthetic(frame, EG(current_execute_data),
+                                      &compile_sample);
+  if (!compile_sample.depth) {
+    return;
+  }
+
+  datadog_php_record_labels labels = {0};
+  datadog_php_record_labels_set_trace_endpoint(&labels);
+  struct ddtrace_profiling_context context =
+      datadog_profiling_get_profiling_context();
+
+  datadog_php_recorder_plugin_record(values, (int64_t)uv_thread_self(),
+                                     &compile_sample, context, &labels);
+}
+
+static const char *file_handle_filename(zend_file_handle *file_handle) {
+#if PHP_VERSION_ID >= 80100
+  return file_handle->filename ? ZSTR_VAL(file_handle->filename) : NULL;
+#else
+  return file_handle->filename;
+#endif
+}
+
+static zend_op_array *
+datadog_php_compile_plugin_compile_file(zend_file_handle *file_handle,
+                                        int type) {
+  if (!enabled || !datadog_php_profiling_recorder_enabled ||
+      !datadog_php_stack_collector_request_sampled()) {
+    return prev_compile_file(file_handle, type);
+  }
+
+  compile_timer timer = compile_timer_start();
+  zend_op_array *op_array = prev_compile_file(file_handle, type);
+  compile_timer_record(timer, file_handle_filename(file_handle));
+  return op_array;
+}
+
+static zend_op_array *
+datadog_php_compile_plugin_compile_string(compile_string_source_t *source,
+                                          compile_string_filename_t *filename) {
+  if (!enabled || !datadog_php_profiling_recorder_enabled ||
+      !datadog_php_stack_collector_request_sampled()) {
+    return prev_compile_string(source, filename);
+  }
+
+  compile_timer timer = compile_timer_start();
+  zend_op_array *op_array = prev_compile_string(source, filename);
+  compile_timer_record(timer, filename);
+  return op_array;
+}
+
+void datadog_php_compile_plugin_startup(zend_extension *extension) {
+  (void)extension;
+
+  enabled = false;
+
+  prev_compile_file = zend_compile_file;
+  zend_compile_file = datadog_php_compile_plugin_compile_file;
+
+  prev_compile_string = zend_compile_string;
+  zend_compile_string = datadog_php_compile_plugin_compile_string;
+}
+
+void datadog_php_compile_plugin_first_activate(
+    datadog_php_profiling_config *config) {
+  enabled = config->profiling_enabled &&
+            config->profiling_experimental_compile_time_enabled;
+}
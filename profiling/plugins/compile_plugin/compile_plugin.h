@@ -0,0 +1,19 @@
+#ifndef DATADOG_PHP_COMPILE_PLUGIN_H
+#define DATADOG_PHP_COMPILE_PLUGIN_H
+
+#include <Zend/zend_extensions.h>
+#include <profiling/config/config.h>
+
+/* The compile plugin wraps zend_compile_file and zend_compile_string so that
+ * the wall and cpu time spent compiling is attributed to a synthetic [compile]
+ * frame on top of the stack which included or eval'd the code. When opcache
+ * is working, cached files do not reach these hooks (unless opcache is loaded
+ * after the profiler), so this mostly shows up when opcache is cold, full, or
+ * misconfigured.
+ */
+
+void datadog_php_compile_plugin_startup(zend_extension *extension);
+void datadog_php_compile_plugin_first_activate(
+    datadog_php_profiling_config *config);
+
+#endif // DATADOG_PHP_COMPILE_PLUGIN_H
@@ -0,0 +1,125 @@
+#include "exception_plugin.h"
+
+#include "../../context.h"
+#include "../recorder_plugin/recorder_plugin.h"
+#include "../stack_collector_plugin/stack_collector_plugin.h"
+#include <components/prng/prng.h>
+#include <stack-collector/stack-collector.h>
+
+#include <Zend/zend_exceptions.h>
+#include <php.h>
+#include <stdatomic.h>
+#include <uv.h>
+
+// must come after php.h
+#include <ext/standard/php_random.h>
+
+#if PHP_VERSION_ID >= 80000
+typedef zend_object exception_t;
+#define EXCEPTION_CE(exception) ((exception)->ce)
+#else
+typedef zval exception_t;
+#define EXCEPTION_CE(exception) Z_OBJCE_P(exception)
+#endif
+
+static void (*prev_throw_exception_hook)(exception_t *);
+static _Atomic bool enabled;
+static uint32_t sampling_distance;
+
+typedef struct exception_thread_globals_s {
+  bool have_prng;
+  datadog_php_prng prng;
+
+  // How many more exceptions need to be thrown until the next one is sampled.
+  uint64_t countdown;
+
+  datadog_php_stack_sample sample; // this is big!
+} exception_thread_globals;
+
+static _Thread_local exception_thread_globals exception_globals;
+
+/* Picks the distance to the next sample uniformly from [1, 2 * distance - 1],
+ * so that on average 1 in every `distance` exceptions is sampled. A fixed
+ * distance would be cheaper, but it can resonate with loops which throw at a
+ * regular interval and always sample the same throw site.
+ */
+static uint64_t next_countdown(void) {
+  uint64_t bound = UINT64_C(2) * sampling_distance - 1;
+  return 1 + datadog_php_prng_below(&exception_globals.prng, bound);
+}
+
+static void exception_plugin_seed(void) {
+  uint64_t seed;
+  if (php_random_bytes_silent(&seed, sizeof seed) != SUCCESS) {
+    seed = uv_hrtime() ^ (uint64_t)uv_thread_self();
+  }
+  datadog_php_prng_ctor(&exception_globals.prng, seed);
+  exception_globals.countdown = next_countdown();
+  exception_globals.have_prng = true;
+}
+
+static void exception_plugin_sample(exception_t *exception) {
+  if (UNEXPECTED(!exception_globals.have_prng)) {
+    exception_plugin_seed();
+  }
+
+  if (EXPECTED(--exception_globals.countdown)) {
+    return;
+  }
+  exception_globals.countdown = next_countdown();
+
+  datadog_php_stack_sample *sample = &exception_globals.sample;
+  datadog_php_stack_collect(EG(current_execute_data), sample);
+  if (!sample->depth) {
+    return;
+  }
+
+  datadog_php_record_values values = {
+      .exceptions = (int64_t)sampling_distance,
+  };
+  datadog_php_stack_collector_weight(&values);
+
+  datadog_php_record_labels labels = {0};
+  zend_class_entry *ce = EXCEPTION_CE(exception);
+  if (ce && ce->name) {
+    datadog_php_record_labels_set_exception_type(&labels, ZSTR_LEN(ce->name),
+                                                 ZSTR_VAL(ce->name));
+  }
+  datadog_php_record_labels_set_trace_endpoint(&labels);
+
+  struct ddtrace_profiling_context context =
+      datadog_profiling_get_profiling_context();
+
+  datadog_php_recorder_plugin_record(values, (int64_t)uv_thread_self(), sample,
+                                     context, &labels);
+}
+
+static void
+datadog_php_exception_plugin_throw_exception_hook(exception_t *exception) {
+  /* The exception is null when the engine re-throws EG(exception), which has
+   * already been through this hook.
+   */
+  if (exception && enabled && datadog_php_profiling_recorder_enabled &&
+      datadog_php_stack_collector_request_sampled()) {
+    exception_plugin_sample(exception);
+  }
+
+  if (prev_throw_exception_hook) {
+    prev_throw_exception_hook(exception);
+  }
+}
+
+void datadog_php_exception_plugin_startup(zend_extension *extension) {
+  (void)extension;
+
+  enabled = false;
+  prev_throw_exception_hook = zend_throw_exception_hook;
+  zend_throw_exception_hook = datadog_php_exception_plugin_throw_exception_hook;
+}
+
+void datadog_php_exception_plugin_first_activate(
+    datadog_php_profiling_config *config) {
+  sampling_distance = config->profiling_exception_sampling_distance;
+  enabled = config->profiling_enabled &&
+            config->profiling_experimental_exception_enabled;
+}
@@ -0,0 +1,17 @@
+#ifndef DATADOG_PHP_EXCEPTION_PLUGIN_H
+#define DATADOG_PHP_EXCEPTION_PLUGIN_H
+
+#include <Zend/zend_extensions.h>
+#include <profiling/config/config.h>
+
+/* The exception plugin samples the stacks where exceptions are thrown. Apps
+ * which use exceptions for control flow may throw a lot of them, so only about
+ * 1 in every DD_PROFILING_EXCEPTION_SAMPLING_DISTANCE exceptions is sampled,
+ * and each sample is weighted by that distance.
+ */
+
+void datadog_php_exception_plugin_startup(zend_extension *extension);
+void datadog_php_exception_plugin_first_activate(
+    datadog_php_profiling_config *config);
+
+#endif // DATADOG_PHP_EXCEPTION_PLUGIN_H
@@ -0,0 +1,101 @@
+#include "gc_plugin.h"
+
+#include "../../context.h"
+#include "../recorder_plugin/recorder_plugin.h"
+#include "../stack_collector_plugin/stack_collector_plugin.h"
+#include <components/clocks/clocks.h>
+#include <stack-collector/stack-collector.h>
+
+#include <Zend/zend_gc.h>
+#include <php.h>
+#include <stdatomic.h>
+#include <uv.h>
+
+static int (*prev_gc_collect_cycles)(void);
+static _Atomic bool enabled;
+
+static _Thread_local datadog_php_stack_sample gc_sample; // this is big!
+
+static uint32_t gc_num_roots(void) {
+#if PHP_VERSION_ID >= 70300
+  zend_gc_status status;
+  zend_gc_get_status(&status);
+  return status.num_roots;
+#else
+  return 0;
+#endif
+}
+
+static int datadog_php_gc_plugin_collect_cycles(void) {
+  if (!enabled || !datadog_php_profiling_recorder_enabled ||
+      !datadog_php_stack_collector_request_sampled()) {
+    return prev_gc_collect_cycles();
+  }
+
+  uint32_t roots = gc_num_roots();
+  bool cpu_enabled = datadog_php_profiling_cpu_time_enabled;
+
+  datadog_php_cpu_time_result cpu_before = {.tag = DATADOG_PHP_CPU_TIME_ERR};
+  if (cpu_enabled) {
+    cpu_before = datadog_php_cpu_time_now();
+  }
+  uint64_t wall_before = uv_hrtime();
+
+  int collected = prev_gc_collect_cycles();
+
+  uint64_t wall_after = uv_hrtime();
+  datadog_php_record_values values = {
+      .wall_time = (int64_t)(wall_after - wall_before),
+  };
+
+  if (cpu_before.tag == DATADOG_PHP_CPU_TIME_OK) {
+    datadog_php_cpu_time_result cpu_after = datadog_php_cpu_time_now();
+    if (cpu_after.tag == DATADOG_PHP_CPU_TIME_OK) {
+      struct timespec then = cpu_before.ok, now = cpu_after.ok;
+      int64_t current = now.tv_sec * INT64_C(1000000000) + now.tv_nsec;
+      int64_t prev = then.tv_sec * INT64_C(1000000000) + then.tv_nsec;
+      values.cpu_time = current - prev;
+    }
+  }
+
+  values.count = datadog_php_stack_collector_exclude_time(values.wall_time,
+                                                         values.cpu_time);
+  datadog_php_stack_collector_weight(&values);
+
+  datadog_php_stack_sample_frame frame = {
+      .function = DATADOG_PHP_STRING_VIEW_LITERAL("[gc]"),
+      .file = DATADOG_PHP_STRING_VIEW_INIT,
+      .lineno = 0,
+  };
+  datadog_php_stack_collect_synthetic(frame, EG(current_execute_data),
+                                      &gc_sample);
+
+  datadog_php_record_labels labels = {
+      .gc = true,
+      .gc_collected = collected > 0 ? (uint32_t)collected : 0,
+      .gc_roots = roots,
+  };
+  datadog_php_record_labels_set_trace_endpoint(&labels);
+
+  struct ddtrace_profiling_context context =
+      datadog_profiling_get_profiling_context();
+
+  datadog_php_recorder_plugin_record(values, (int64_t)uv_thread_self(),
+                                     &gc_sample, context, &labels);
+
+  return collected;
+}
+
+void datadog_php_gc_plugin_startup(zend_extension *extension) {
+  (void)extension;
+
+  enabled = false;
+  prev_gc_collect_cycles = gc_collect_cycles;
+  gc_collect_cycles = datadog_php_gc_plugin_collect_cycles;
+}
+
+void datadog_php_gc_plugin_first_activate(
+    datadog_php_profiling_config *config) {
+  enabled = config->profiling_enabled &&
+            config->profiling_experimental_gc_enabled;
+}
@@ -0,0 +1,15 @@
+#ifndef DATADOG_PHP_GC_PLUGIN_H
+#define DATADOG_PHP_GC_PLUGIN_H
+
+#include <Zend/zend_extensions.h>
+#include <profiling/config/config.h>
+
+/* The gc plugin wraps the engine's gc_collect_cycles function pointer so that
+ * the wall and cpu time spent collecting cycles is attributed to a synthetic
+ * [gc] frame on top of the stack which triggered the collection.
+ */
+
+void datadog_php_gc_plugin_startup(zend_extension *extension);
+void datadog_php_gc_plugin_first_activate(datadog_php_profiling_config *config);
+
+#endif // DATADOG_PHP_GC_PLUGIN_H
@@ -5,12 +5,18 @@
 #include <plugins/log_plugin/log_plugin.h>
 
 #include <components/arena/arena.h>
+#include <components/backoff/backoff.h>
 #include <components/channel/channel.h>
 #include <components/clocks/clocks.h>
+#include <components/endpoint_totals/endpoint_totals.h>
+#include <components/line_totals/line_totals.h>
 #include <components/string_view/string_view.h>
+#include <components/top_k/top_k.h>
 #include <ddprof/ffi.h>
 #include <php.h>
+#include <signal.h>
 #include <stdlib.h>
+#include <time.h>
 #include <uv.h>
 
 // must come after php.h
@@ -20,6 +26,8 @@
 
 atomic_bool datadog_php_profiling_recorder_enabled = false;
 bool datadog_php_profiling_cpu_time_enabled = false;
+_Atomic uint64_t datadog_php_profiling_burst_until = 0;
+_Atomic uint32_t datadog_php_profiling_burst_interval_ms = 0;
 
 /* thread_id will point to thread_id_v if the thread is created successfully;
  * null otherwise.
@@ -29,6 +37,132 @@ static datadog_php_channel channel;
 static ddprof_ffi_ProfileExporterV3 *exporter = NULL;
 static const datadog_php_profiling_config *global_config = NULL;
 
+/* With line hotspots enabled, the values of each sample are also totaled by
+ * the file and line of its leaf PHP frame, and the totals are uploaded with
+ * the profile as line-hotspots.json. Only the recorder thread touches them.
+ */
+static bool line_hotspots_enabled = false;
+static datadog_php_line_totals line_totals;
+
+/* The values of samples with a trace endpoint are totaled per endpoint, and
+ * uploaded with the profile as endpoint-totals.json, so the most expensive
+ * endpoints can be seen without aggregating the profile. Only the recorder
+ * thread touches them.
+ */
+static datadog_php_endpoint_totals endpoint_totals;
+
+/* With the top enabled, the heaviest leaf functions and stacks of the current
+ * period are summarized for datadog_profiling_top and phpinfo. They're ranked
+ * by cpu time if it's enabled, or else by wall time. The recorder thread adds
+ * to them while PHP threads copy them, so they're guarded by a mutex.
+ */
+static bool have_top = false;
+static uv_mutex_t top_mutex;
+static datadog_php_top_k top_functions;
+static datadog_php_top_k top_stacks;
+
+/* With the timeline enabled, every sample gets an end_timestamp_ns label of
+ * when it was recorded, unless its plugin already set a more precise one.
+ */
+static bool timeline_enabled = false;
+
+/* Custom labels from datadog_profiling_set_label. Each thread refers to the
+ * interned label set of its current request by id, and samples only carry the
+ * id for the recorder thread to expand. PHP threads intern sets while the
+ * recorder thread reads them, so the tables are guarded by a mutex, but
+ * interned sets never change, so they can be read after unlocking.
+ *
+ * So that long-lived workers don't run out of room, there are two generations
+ * of sets. At the end of an upload period in which the current table got half
+ * full or ran out of room, the older table is cleared and becomes the current
+ * one. Only the recorder thread clears tables, and it's done adding the older
+ * generation's samples by then. A thread whose set is in the previous
+ * generation moves it over the next time it needs the id. One which didn't
+ * for a whole generation loses its labels, as do samples which were still
+ * queued by then.
+ */
+#define LABEL_SETS_STRINGS_SIZE (256u * 1024u)
+static bool have_label_sets = false;
+static uv_mutex_t label_sets_mutex;
+static datadog_php_label_sets label_sets[2]; // indexed by the epoch's low bit
+static uint8_t label_sets_strings[2][LABEL_SETS_STRINGS_SIZE];
+static _Atomic uint32_t label_sets_epoch; // only changed with the mutex held
+static bool label_sets_overflowed;        // guarded by the mutex
+ZEND_TLS uint32_t label_set_id;
+ZEND_TLS uint32_t label_set_epoch; // the generation label_set_id belongs to
+
+/* Moves the current thread's label set into the current generation if it's
+ * in the previous one, and returns the current generation's table. Call this
+ * with the mutex held.
+ */
+static datadog_php_label_sets *label_set_refresh(void) {
+  uint32_t epoch = atomic_load(&label_sets_epoch);
+  datadog_php_label_sets *sets = &label_sets[epoch & 1];
+  if (label_set_id && label_set_epoch != epoch) {
+    const datadog_php_label_set *set = NULL;
+    if (epoch - label_set_epoch == 1) {
+      set = datadog_php_label_sets_get(&label_sets[label_set_epoch & 1],
+                                       label_set_id);
+    }
+    uint32_t id = 0;
+    if (set && !datadog_php_label_sets_intern(sets, set, &id)) {
+      label_sets_overflowed = true;
+    }
+    label_set_id = id;
+  }
+  label_set_epoch = epoch;
+  return sets;
+}
+
+// Starts a new generation of label sets if the current one is filling up.
+static void label_sets_recycle(void) {
+  if (!have_label_sets) {
+    return;
+  }
+  uv_mutex_lock(&label_sets_mutex);
+  uint32_t epoch = atomic_load(&label_sets_epoch);
+  if (label_sets_overflowed ||
+      label_sets[epoch & 1].len >= DATADOG_PHP_LABEL_SETS_CAPACITY / 2) {
+    datadog_php_label_sets_clear(&label_sets[(epoch + 1) & 1]);
+    atomic_store(&label_sets_epoch, epoch + 1);
+    label_sets_overflowed = false;
+  }
+  uv_mutex_unlock(&label_sets_mutex);
+}
+
+/* What became of an upload, for the diagnostics and the backoff. */
+typedef struct export_outcome_s {
+  uint16_t code;  // HTTP status code, 0 if there was no response
+  bool retryable; // whether it failed in a way which may heal, e.g. no agent
+  uint8_t error_len;
+  char error[127]; // why there was no response, if there wasn't one
+  uint64_t latency_ns;
+  uint64_t bytes; // size of the files in the request
+} export_outcome;
+
+/* The recorder keeps statistics of its uploads, so phpinfo can show them
+ * instead of uploading a profile itself, which can block for as long as the
+ * upload timeout. The recorder thread updates them while PHP threads read
+ * them, so they're guarded by a mutex. Samples are counted with atomics, as
+ * that happens for every sample.
+ */
+typedef struct upload_summary_s {
+  uint64_t uploads;
+  uint64_t failures;
+  uint64_t skipped; // while backing off
+  time_t last_at;   // when the last upload finished
+  time_t retry_at;  // when uploads resume if backing off, or else 0
+  uint32_t consecutive_failures;
+  uint64_t last_samples;
+  export_outcome last;
+} upload_summary;
+
+static bool have_upload_stats = false;
+static uv_mutex_t upload_stats_mutex;
+static upload_summary upload_stats;
+static _Atomic uint64_t samples_recorded = 0;
+static _Atomic uint64_t samples_dropped = 0;
+
 typedef struct record_msg_s record_msg;
 
 /**
@@ -40,14 +174,18 @@ struct record_msg_s {
   datadog_php_record_values record_values;
   int64_t thread_id;
   ddtrace_profiling_context context;
+  datadog_php_record_labels labels;
+  bool burst; // whether it was recorded during a burst
+  uint32_t label_set_id; // the custom labels, 0 if there are none
+  uint32_t label_set_epoch;
   datadog_php_stack_sample sample;
 };
 
-_Static_assert(sizeof(record_msg) > 7168 && sizeof(record_msg) <= 8192,
-               "size of record_msg needs to nicely fit in 8KiB");
+_Static_assert(sizeof(record_msg) > 8192 && sizeof(record_msg) <= 9216,
+               "size of record_msg needs to nicely fit in 9KiB");
 
 /* CHANNEL_CAPACITY * sizeof(record_msg) = approx max memory used by channel
- *              256 *              8 KiB = 2048 KiB, or 2 MiB
+ *              256 *              9 KiB = 2304 KiB, or 2.25 MiB
  * At 1 sample per 10 milliseconds, that's 2.56 seconds worth of data that can
  * be kept in the channel at one time.
  */
@@ -60,9 +198,30 @@ static const uint16_t CHANNEL_CAPACITY = UINT16_C(256);
  */
 static const uint64_t UPLOAD_TIMEOUT_MS = 10000;
 
+void datadog_php_record_labels_set_exception_type(
+    datadog_php_record_labels *labels, size_t len, const char *ptr) {
+  size_t capacity = sizeof labels->exception_type;
+  size_t n = len < capacity ? len : capacity;
+  memcpy(labels->exception_type, ptr, n);
+  labels->exception_type_len = (uint8_t)n;
+}
+
+void datadog_php_record_labels_set_trace_endpoint(
+    datadog_php_record_labels *labels) {
+  ddtrace_profiling_endpoint endpoint =
+      datadog_profiling_get_profiling_endpoint();
+  size_t capacity = sizeof labels->trace_endpoint;
+  size_t n = endpoint.len < capacity ? endpoint.len : capacity;
+  if (n) {
+    memcpy(labels->trace_endpoint, endpoint.ptr, n);
+  }
+  labels->trace_endpoint_len = (uint8_t)n;
+}
+
 __attribute__((nonnull)) bool datadog_php_recorder_plugin_record(
     datadog_php_record_values record_values, int64_t tid,
-    const datadog_php_stack_sample *sample, ddtrace_profiling_context context) {
+    const datadog_php_stack_sample *sample, ddtrace_profiling_context context,
+    const datadog_php_record_labels *labels) {
   if (!datadog_php_profiling_recorder_enabled) {
     const char *str =
         "[Datadog Profiling] Sample dropped because profiling has been disabled.";
@@ -76,11 +235,30 @@ __attribute__((nonnull)) bool datadog_php_recorder_plugin_record(
    *       channel?
    */
   record_msg *message = malloc(sizeof(record_msg));
-  if (message) {
+  if (!message) {
+    atomic_fetch_add_explicit(&samples_dropped, 1, memory_order_relaxed);
+  } else {
     message->record_values = record_values;
     message->sample = *sample;
     message->thread_id = tid;
     message->context = context;
+    message->labels = *labels;
+    message->label_set_id = 0;
+    if (label_set_id) {
+      if (label_set_epoch != atomic_load(&label_sets_epoch)) {
+        uv_mutex_lock(&label_sets_mutex);
+        (void)label_set_refresh();
+        uv_mutex_unlock(&label_sets_mutex);
+      }
+      message->label_set_id = label_set_id;
+      message->label_set_epoch = label_set_epoch;
+    }
+
+    uint64_t now = uv_hrtime();
+    message->burst = now < datadog_php_profiling_burst_until;
+    if (timeline_enabled && !message->labels.end_timestamp) {
+      message->labels.end_timestamp = now;
+    }
 
     bool success = channel.sender.send(&channel.sender, message);
     if (!success) {
@@ -90,6 +268,7 @@ __attribute__((nonnull)) bool datadog_php_recorder_plugin_record(
       datadog_php_string_view msg = {strlen(str), str};
       prof_logger.log(DATADOG_PHP_LOG_DEBUG, msg);
       free(message);
+      atomic_fetch_add_explicit(&samples_dropped, 1, memory_order_relaxed);
     }
     return success;
   }
@@ -111,14 +290,87 @@ static instant instant_now(void) {
   return now;
 }
 
+bool datadog_php_recorder_plugin_burst(uint32_t seconds, uint32_t interval_ms) {
+  if (!datadog_php_profiling_recorder_enabled) {
+    return false;
+  }
+  // Set the interval first so a collector which sees the new end uses it.
+  datadog_php_profiling_burst_interval_ms = interval_ms;
+  datadog_php_profiling_burst_until =
+      uv_hrtime() + seconds * UINT64_C(1000000000);
+  return true;
+}
+
+/* The burst signal starts a burst of this length and interval, as there is no
+ * way to pass arguments along with it.
+ */
+#define SIGNAL_BURST_SECONDS 60
+#define SIGNAL_BURST_INTERVAL_MS 1
+
+static int burst_signal;
+static struct sigaction prev_burst_action;
+
+static void burst_signal_handler(int signo) {
+  (void)signo;
+  (void)datadog_php_recorder_plugin_burst(SIGNAL_BURST_SECONDS,
+                                          SIGNAL_BURST_INTERVAL_MS);
+}
+
+static void burst_signal_install(uint32_t signo) {
+  burst_signal = 0;
+  if (!signo) {
+    return;
+  }
+
+  struct sigaction action = {.sa_handler = burst_signal_handler};
+  sigemptyset(&action.sa_mask);
+  action.sa_flags = SA_RESTART;
+  if (sigaction((int)signo, &action, &prev_burst_action) != 0) {
+    prof_logger.log_cstr(
+        DATADOG_PHP_LOG_WARN,
+        "[Datadog Profiling] Failed to install the burst signal handler.");
+    return;
+  }
+  burst_signal = (int)signo;
+}
+
+static void burst_signal_uninstall(void) {
+  if (burst_signal) {
+    (void)sigaction(burst_signal, &prev_burst_action, NULL);
+    burst_signal = 0;
+  }
+}
+
+static void export_outcome_set_error(export_outcome *outcome,
+                                     datadog_php_string_view error) {
+  if (outcome) {
+    size_t len = error.len < sizeof outcome->error ? error.len
+                                                   : sizeof outcome->error;
+    outcome->error_len = (uint8_t)len;
+    memcpy(outcome->error, error.ptr, len);
+  }
+}
+
+/**
+ * Uploads the profile, and if `outcome` isn't null, describes how it went.
+ */
 static bool ddprof_ffi_export(datadog_php_static_logger *logger,
                               const struct ddprof_ffi_Profile *profile,
-                              uint64_t timeout_ms) {
+                              uint64_t timeout_ms, bool burst,
+                              const datadog_php_line_totals *lines,
+                              const datadog_php_endpoint_totals *endpoints,
+                              export_outcome *outcome) {
+  if (outcome) {
+    *outcome = (export_outcome){0};
+  }
+
   ddprof_ffi_SerializeResult serialize_result =
       ddprof_ffi_Profile_serialize(profile);
   if (serialize_result.tag == DDPROF_FFI_SERIALIZE_RESULT_ERR) {
     logger->log_cstr(DATADOG_PHP_LOG_WARN,
                      "[Datadog Profiling] Failed to serialize profile.");
+    export_outcome_set_error(
+        outcome, datadog_php_string_view_from_cstr("failed to serialize"));
     ddprof_ffi_SerializeResult_drop(serialize_result);
     return false;
   }
@@ -128,15 +380,49 @@ static bool ddprof_ffi_export(datadog_php_static_logger *logger,
   ddprof_ffi_Timespec start = encoded_profile->start;
   ddprof_ffi_Timespec end = encoded_profile->end;
 
-  ddprof_ffi_File files_[] = {{
+  ddprof_ffi_File files_[3] = {{
       .name = CHARSLICE_C("profile.pprof"),
       .file = ddprof_ffi_Vec_u8_as_slice(&encoded_profile->buffer),
   }};
 
   struct ddprof_ffi_Slice_file files = {
       .ptr = files_,
-      .len = sizeof files_ / sizeof *files_,
+      .len = 1,
   };
+
+  // needs to outlive the request
+  char *lines_json = NULL;
+  if (lines && lines->len) {
+    size_t len = datadog_php_line_totals_json(lines, NULL, 0);
+    lines_json = malloc(len);
+    if (lines_json) {
+      (void)datadog_php_line_totals_json(lines, lines_json, len);
+      files_[files.len++] = (ddprof_ffi_File){
+          .name = CHARSLICE_C("line-hotspots.json"),
+          .file = {.ptr = (const uint8_t *)lines_json, .len = len},
+      };
+    } else {
+      logger->log_cstr(
+          DATADOG_PHP_LOG_WARN,
+          "[Datadog Profiling] Failed to allocate storage for line hotspots.");
+    }
+  }
+  char *endpoints_json = NULL;
+  if (endpoints && endpoints->len) {
+    size_t len = datadog_php_endpoint_totals_json(endpoints, NULL, 0);
+    endpoints_json = malloc(len);
+    if (endpoints_json) {
+      (void)datadog_php_endpoint_totals_json(endpoints, endpoints_json, len);
+      files_[files.len++] = (ddprof_ffi_File){
+          .name = CHARSLICE_C("endpoint-totals.json"),
+          .file = {.ptr = (const uint8_t *)endpoints_json, .len = len},
+      };
+    } else {
+      logger->log_cstr(
+          DATADOG_PHP_LOG_WARN,
+          "[Datadog Profiling] Failed to allocate storage for endpoint totals.");
+    }
+  }
   // needs to outlive tags
   char runtime_val[37] = {0};
 
@@ -184,24 +470,56 @@ static bool ddprof_ffi_export(datadog_php_static_logger *logger,
     ddprof_ffi_PushTagResult_drop(result);
   }
 
+  // Tag burst profiles so they can be told apart from the regular ones.
+  if (burst) {
+    struct ddprof_ffi_PushTagResult result = ddprof_ffi_Vec_tag_push(
+        &tags, CHARSLICE_C("burst"), CHARSLICE_C("true"));
+    if (result.tag == DDPROF_FFI_PUSH_TAG_RESULT_ERR) {
+      datadog_php_string_view message = {
+          .len = result.err.len,
+          .ptr = (const char *)result.err.ptr,
+      };
+      logger->log(DATADOG_PHP_LOG_WARN, message);
+    }
+    ddprof_ffi_PushTagResult_drop(result);
+  }
+
   ddprof_ffi_Request *request = ddprof_ffi_ProfileExporterV3_build(
       exporter, start, end, files, &tags, timeout_ms);
   ddprof_ffi_Vec_tag_drop(tags);
 
+  if (outcome) {
+    for (size_t i = 0; i != files.len; ++i) {
+      outcome->bytes += files_[i].file.len;
+    }
+  }
+
   bool succeeded = false;
   if (request) {
-    struct ddprof_ffi_SendResult result =
+    uint64_t send_started_at = uv_hrtime();
+    struct ddprof_ffi_SendResult send_result =
         ddprof_ffi_ProfileExporterV3_send(exporter, request, NULL);
+    if (outcome) {
+      outcome->latency_ns = uv_hrtime() - send_started_at;
+    }
 
-    if (result.tag == DDPROF_FFI_SEND_RESULT_FAILURE) {
+    if (send_result.tag == DDPROF_FFI_SEND_RESULT_FAILURE) {
       datadog_php_string_view messages[2] = {
           datadog_php_string_view_from_cstr(
               "[Datadog Profiling] Failed to upload profile: "),
-          {result.failure.len, (const char *)result.failure.ptr},
+          {send_result.failure.len, (const char *)send_result.failure.ptr},
       };
       logger->logv(DATADOG_PHP_LOG_WARN, 2, messages);
-    } else if (result.tag == DDPROF_FFI_SEND_RESULT_HTTP_RESPONSE) {
-      uint16_t code = result.http_response.code;
+      export_outcome_set_error(outcome, messages[1]);
+      if (outcome) {
+        outcome->retryable = true;
+      }
+    } else if (send_result.tag == DDPROF_FFI_SEND_RESULT_HTTP_RESPONSE) {
+      uint16_t code = send_result.http_response.code;
+      if (outcome) {
+        outcome->code = code;
+        outcome->retryable = code == 429 || code >= 500;
+      }
       if (200 <= code && code < 300) {
         logger->log_cstr(DATADOG_PHP_LOG_INFO,
                          "[Datadog Profiling] Successfully uploaded profile.");
@@ -220,12 +538,16 @@ static bool ddprof_ffi_export(datadog_php_static_logger *logger,
       }
     }
 
-    ddprof_ffi_SendResult_drop(result);
+    ddprof_ffi_SendResult_drop(send_result);
   } else {
     logger->log_cstr(DATADOG_PHP_LOG_WARN,
                      "[Datadog Profiling] Failed to create HTTP request.");
+    export_outcome_set_error(
+        outcome, datadog_php_string_view_from_cstr("failed to build request"));
   }
 
+  free(endpoints_json);
+  free(lines_json);
   ddprof_ffi_SerializeResult_drop(serialize_result);
   return succeeded;
 }
@@ -263,6 +585,121 @@ static struct ddprof_ffi_Slice_c_char label_i64(char buffer[static 21],
   return val;
 }
 
+/**
+ * Converts a monotonic uv_hrtime timestamp into nanoseconds since the epoch,
+ * which is what the end_timestamp_ns label is expected to hold.
+ */
+static int64_t epoch_ns_from_hrtime(uint64_t hrtime) {
+  struct timespec now;
+  if (clock_gettime(CLOCK_REALTIME, &now) != 0) {
+    return 0;
+  }
+  int64_t realtime = now.tv_sec * INT64_C(1000000000) + now.tv_nsec;
+  return realtime - (int64_t)(uv_hrtime() - hrtime);
+}
+
+/* Some tools assume the last value type is the "primary" one, so put
+ * cpu-time last, as that's what the Datadog UI will default to (once it is
+ * released).
+ */
+enum value_type_index {
+  VALUE_TYPE_SAMPLE,
+  VALUE_TYPE_WALL_TIME,
+  VALUE_TYPE_EXCEPTION_SAMPLES,
+  VALUE_TYPE_MEMORY_USAGE,
+  VALUE_TYPE_MEMORY_PEAK_GROWTH,
+  VALUE_TYPE_CPU_TIME,
+  VALUE_TYPE_COUNT,
+};
+
+static const struct ddprof_ffi_ValueType all_value_types[VALUE_TYPE_COUNT] = {
+    [VALUE_TYPE_SAMPLE] =
+        {
+            .type_ = CHARSLICE_C("sample"),
+            .unit = CHARSLICE_C("count"),
+        },
+    [VALUE_TYPE_WALL_TIME] =
+        {
+            .type_ = CHARSLICE_C("wall-time"),
+            .unit = CHARSLICE_C("nanoseconds"),
+        },
+    [VALUE_TYPE_EXCEPTION_SAMPLES] =
+        {
+            .type_ = CHARSLICE_C("exception-samples"),
+            .unit = CHARSLICE_C("count"),
+        },
+    /* Memory usage is a gauge, but it's multiplied by the sample count so
+     * that memory-usage / sample is the average usage of a stack.
+     */
+    [VALUE_TYPE_MEMORY_USAGE] =
+        {
+            .type_ = CHARSLICE_C("memory-usage"),
+            .unit = CHARSLICE_C("bytes"),
+        },
+    [VALUE_TYPE_MEMORY_PEAK_GROWTH] =
+        {
+            .type_ = CHARSLICE_C("memory-peak-growth"),
+            .unit = CHARSLICE_C("bytes"),
+        },
+    [VALUE_TYPE_CPU_TIME] =
+        {
+            .type_ = CHARSLICE_C("cpu-time"),
+            .unit = CHARSLICE_C("nanoseconds"),
+        },
+};
+
+/* The value types which are enabled by configuration, in the same order as
+ * all_value_types. The sample and wall-time types are always enabled.
+ */
+static bool value_type_enabled[VALUE_TYPE_COUNT];
+static struct ddprof_ffi_ValueType value_types[VALUE_TYPE_COUNT];
+static size_t value_types_len;
+
+static void value_types_ctor(const datadog_php_profiling_config *config) {
+  value_type_enabled[VALUE_TYPE_SAMPLE] = true;
+  value_type_enabled[VALUE_TYPE_WALL_TIME] = true;
+  value_type_enabled[VALUE_TYPE_EXCEPTION_SAMPLES] =
+      config->profiling_experimental_exception_enabled;
+  value_type_enabled[VALUE_TYPE_MEMORY_USAGE] =
+      config->profiling_experimental_memory_enabled;
+  value_type_enabled[VALUE_TYPE_MEMORY_PEAK_GROWTH] =
+      config->profiling_experimental_memory_enabled;
+  value_type_enabled[VALUE_TYPE_CPU_TIME] =
+      config->profiling_experimental_cpu_enabled;
+
+  value_types_len = 0;
+  for (unsigned i = 0; i != VALUE_TYPE_COUNT; ++i) {
+    if (value_type_enabled[i]) {
+      value_types[value_types_len++] = all_value_types[i];
+    }
+  }
+}
+
+/**
+ * Writes the enabled values of `record_values` into `values`, in the same
+ * order as the profile's value types. Returns how many were written.
+ */
+static size_t
+record_values_slice(const datadog_php_record_values *record_values,
+                    int64_t values[static VALUE_TYPE_COUNT]) {
+  const int64_t all_values[VALUE_TYPE_COUNT] = {
+      [VALUE_TYPE_SAMPLE] = (int64_t)record_values->count,
+      [VALUE_TYPE_WALL_TIME] = record_values->wall_time,
+      [VALUE_TYPE_EXCEPTION_SAMPLES] = record_values->exceptions,
+      [VALUE_TYPE_MEMORY_USAGE] = record_values->memory_usage,
+      [VALUE_TYPE_MEMORY_PEAK_GROWTH] = record_values->memory_peak_growth,
+      [VALUE_TYPE_CPU_TIME] = record_values->cpu_time,
+  };
+
+  size_t len = 0;
+  for (unsigned i = 0; i != VALUE_TYPE_COUNT; ++i) {
+    if (value_type_enabled[i]) {
+      values[len++] = all_values[i];
+    }
+  }
+  return len;
+}
+
 static void datadog_php_recorder_add(struct ddprof_ffi_Profile *profile,
                                      record_msg *message) {
   uint32_t locations_capacity = message->sample.depth;
@@ -298,6 +735,30 @@ static void datadog_php_recorder_add(struct ddprof_ffi_Profile *profile,
     }
 
     struct ddprof_ffi_Line *line = lines + locations_size;
+    if (frame.native) {
+      /* Native frames are named after their symbol if it's exported, but the
+       * mapping is what lets them be symbolized offline: the address's offset
+       * in the object's file is address - memory_start + file_offset.
+       */
+      line->function = (struct ddprof_ffi_Function){
+          .name = {.ptr = frame.function.ptr, .len = frame.function.len},
+      };
+      line->line = 0;
+      locations[locations_size++] = (struct ddprof_ffi_Location){
+          .mapping =
+              {
+                  .memory_start = frame.mapping_start,
+                  .memory_limit = frame.mapping_limit,
+                  .file_offset = frame.mapping_offset,
+                  .filename = {.ptr = frame.file.ptr, .len = frame.file.len},
+              },
+          .address = frame.address,
+          .lines = {.ptr = line, .len = 1},
+          .is_folded = false,
+      };
+      continue;
+    }
+
     struct ddprof_ffi_Function function = {
         .name = {.ptr = frame.function.ptr, .len = frame.function.len},
         .filename = {.ptr = frame.file.ptr, .len = frame.file.len},
@@ -317,14 +778,11 @@ static void datadog_php_recorder_add(struct ddprof_ffi_Profile *profile,
   }
   datadog_php_stack_sample_iterator_dtor(&iterator);
 
-  int64_t values_storage[3] = {
-      (int64_t)message->record_values.count,
-      message->record_values.wall_time,
-      message->record_values.cpu_time,
+  int64_t values_storage[VALUE_TYPE_COUNT];
+  struct ddprof_ffi_Slice_i64 values = {
+      .ptr = values_storage,
+      .len = record_values_slice(&message->record_values, values_storage),
   };
-  size_t values_storage_len = datadog_php_profiling_cpu_time_enabled ? 3 : 2;
-  struct ddprof_ffi_Slice_i64 values = {.ptr = values_storage,
-                                        .len = values_storage_len};
 
   char thread_id_str[24] = "";
   struct ddprof_ffi_Slice_c_char thread_id_slice =
@@ -338,16 +796,108 @@ static void datadog_php_recorder_add(struct ddprof_ffi_Profile *profile,
   struct ddprof_ffi_Slice_c_char span_id =
       label_u64(span_id_str, message->context.span_id);
 
-  ddprof_ffi_Label labels[] = {
-      {.key = {ZEND_STRL("thread id")}, .str = thread_id_slice},
-      {.key = {ZEND_STRL("local root span id")}, .str = local_root_span_id},
-      {.key = {ZEND_STRL("span id")}, .str = span_id},
+  ddprof_ffi_Label labels[11 + DATADOG_PHP_LABEL_SET_CAPACITY];
+  size_t n_labels = 0;
+  labels[n_labels++] = (ddprof_ffi_Label){
+      .key = {ZEND_STRL("thread id")},
+      .str = thread_id_slice,
   };
 
-  size_t n_labels = sizeof labels / sizeof labels[0];
-  // seems something failed
-  if (span_id.len == 0 || local_root_span_id.len == 0) {
-    n_labels -= 2;
+  // if either is empty then it seems something failed
+  if (span_id.len != 0 && local_root_span_id.len != 0) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("local root span id")},
+        .str = local_root_span_id,
+    };
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("span id")},
+        .str = span_id,
+    };
+  }
+
+  const datadog_php_record_labels *record_labels = &message->labels;
+  if (record_labels->gc) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("gc collected")},
+        .num = record_labels->gc_collected,
+    };
+    // PHP < 7.3 doesn't expose the number of roots
+    if (record_labels->gc_roots) {
+      labels[n_labels++] = (ddprof_ffi_Label){
+          .key = {ZEND_STRL("gc roots")},
+          .num = record_labels->gc_roots,
+      };
+    }
+  }
+
+  if (record_labels->fiber_id) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("fiber id")},
+        .num = record_labels->fiber_id,
+    };
+  }
+
+  if (record_labels->end_timestamp) {
+    int64_t end_timestamp_ns =
+        epoch_ns_from_hrtime(record_labels->end_timestamp);
+    if (end_timestamp_ns) {
+      labels[n_labels++] = (ddprof_ffi_Label){
+          .key = {ZEND_STRL("end_timestamp_ns")},
+          .num = end_timestamp_ns,
+      };
+    }
+  }
+
+  if (record_labels->trace_endpoint_len) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("trace endpoint")},
+        .str = {record_labels->trace_endpoint,
+                record_labels->trace_endpoint_len},
+    };
+  }
+
+  if (record_labels->wait_reason_len) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("wait reason")},
+        .str = {record_labels->wait_reason, record_labels->wait_reason_len},
+    };
+  }
+
+  if (record_labels->opcode_len) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("opcode")},
+        .str = {record_labels->opcode, record_labels->opcode_len},
+    };
+  }
+
+  if (record_labels->exception_type_len) {
+    labels[n_labels++] = (ddprof_ffi_Label){
+        .key = {ZEND_STRL("exception type")},
+        .str = {record_labels->exception_type,
+                record_labels->exception_type_len},
+    };
+  }
+
+  /* Only the recorder thread changes the epoch, so the generation can't be
+   * cleared between here and the end of this function.
+   */
+  const datadog_php_label_set *custom_labels = NULL;
+  uint32_t epoch = atomic_load(&label_sets_epoch);
+  if (message->label_set_id && epoch - message->label_set_epoch <= 1) {
+    uv_mutex_lock(&label_sets_mutex);
+    custom_labels =
+        datadog_php_label_sets_get(&label_sets[message->label_set_epoch & 1],
+                                   message->label_set_id);
+    uv_mutex_unlock(&label_sets_mutex);
+  }
+  if (custom_labels) {
+    for (uint8_t i = 0; i != custom_labels->len; ++i) {
+      const datadog_php_label *label = &custom_labels->labels[i];
+      labels[n_labels++] = (ddprof_ffi_Label){
+          .key = {label->key.ptr, label->key.len},
+          .str = {label->value.ptr, label->value.len},
+      };
+    }
   }
 
   struct ddprof_ffi_Sample sample = {
@@ -384,26 +934,6 @@ static const struct ddprof_ffi_Period period = {
 };
 
 static struct ddprof_ffi_Profile *profile_new(void) {
-
-  /* Some tools assume the last value type is the "primary" one, so put
-   * cpu-time last, as that's what the Datadog UI will default to (once it is
-   * released).
-   */
-  static struct ddprof_ffi_ValueType value_types[3] = {
-      {
-          .type_ = CHARSLICE_C("sample"),
-          .unit = CHARSLICE_C("count"),
-      },
-      {
-          .type_ = CHARSLICE_C("wall-time"),
-          .unit = CHARSLICE_C("nanoseconds"),
-      },
-      {
-          .type_ = CHARSLICE_C("cpu-time"),
-          .unit = CHARSLICE_C("nanoseconds"),
-      },
-  };
-
   /* Note that the maximum memory used by the profile can be estimated with
    * decent accuracy by using the period, sample frequency, maximum payload size
    * of each sample, and the channel's capacity.
@@ -412,11 +942,208 @@ static struct ddprof_ffi_Profile *profile_new(void) {
    */
   struct ddprof_ffi_Slice_value_type sample_types = {
       .ptr = value_types,
-      .len = datadog_php_profiling_cpu_time_enabled ? 3 : 2,
+      .len = value_types_len,
   };
   return ddprof_ffi_Profile_new(sample_types, &period);
 }
 
+static void endpoint_totals_add(const record_msg *message) {
+  const datadog_php_record_labels *labels = &message->labels;
+  if (!labels->trace_endpoint_len) {
+    return;
+  }
+
+  const datadog_php_record_values *values = &message->record_values;
+  datadog_php_string_view endpoint = {labels->trace_endpoint_len,
+                                      labels->trace_endpoint};
+  (void)datadog_php_endpoint_totals_add(&endpoint_totals, endpoint,
+                                        (int64_t)values->count,
+                                        values->wall_time, values->cpu_time);
+}
+
+/**
+ * Adds the message's values to the line of its leaf PHP frame, which is the
+ * first one with a file. Time in internal functions counts towards the line
+ * which called them. Samples without values, such as exceptions, are skipped.
+ */
+static void line_totals_add(const record_msg *message) {
+  const datadog_php_record_values *values = &message->record_values;
+  if (!values->count && !values->wall_time && !values->cpu_time) {
+    return;
+  }
+
+  datadog_php_stack_sample_iterator iterator;
+  for (iterator = datadog_php_stack_sample_iterator_ctor(&message->sample);
+       datadog_php_stack_sample_iterator_valid(&iterator);
+       datadog_php_stack_sample_iterator_next(&iterator)) {
+    datadog_php_stack_sample_frame frame =
+        datadog_php_stack_sample_iterator_frame(&iterator);
+    if (!frame.native && frame.file.len && frame.lineno > 0) {
+      (void)datadog_php_line_totals_add(&line_totals, frame.file, frame.lineno,
+                                        (int64_t)values->count,
+                                        values->wall_time, values->cpu_time);
+      break;
+    }
+  }
+  datadog_php_stack_sample_iterator_dtor(&iterator);
+}
+
+/* The folded stack of a sample, from the root to the leaf, separated by ';'.
+ * There's room for every function name in a sample plus the separators.
+ */
+static char top_stack_key[sizeof(((datadog_php_stack_sample *)0)->buffer) +
+                          DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH + 1];
+
+/**
+ * Adds the message's values to its leaf function and its folded stack. Like
+ * for line totals, samples without values are skipped.
+ */
+static void top_add(const record_msg *message) {
+  const datadog_php_record_values *values = &message->record_values;
+  if (!values->count && !values->wall_time && !values->cpu_time) {
+    return;
+  }
+
+  datadog_php_string_view functions[DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH + 1];
+  size_t depth = 0;
+  datadog_php_stack_sample_iterator iterator;
+  for (iterator = datadog_php_stack_sample_iterator_ctor(&message->sample);
+       datadog_php_stack_sample_iterator_valid(&iterator);
+       datadog_php_stack_sample_iterator_next(&iterator)) {
+    datadog_php_stack_sample_frame frame =
+        datadog_php_stack_sample_iterator_frame(&iterator);
+    if (!is_empty_frame(&frame)) {
+      functions[depth++] = frame.function;
+    }
+  }
+  datadog_php_stack_sample_iterator_dtor(&iterator);
+  if (!depth) {
+    return;
+  }
+
+  size_t len = 0;
+  for (size_t i = depth; i--;) {
+    memcpy(top_stack_key + len, functions[i].ptr, functions[i].len);
+    len += functions[i].len;
+    if (i) {
+      top_stack_key[len++] = ';';
+    }
+  }
+  datadog_php_string_view stack = {len, top_stack_key};
+
+  int64_t weight = datadog_php_profiling_cpu_time_enabled ? values->cpu_time
+                                                          : values->wall_time;
+  int64_t count = (int64_t)values->count;
+  uv_mutex_lock(&top_mutex);
+  datadog_php_top_k_add(&top_functions, functions[0], weight, count,
+                        values->wall_time, values->cpu_time);
+  datadog_php_top_k_add(&top_stacks, stack, weight, count, values->wall_time,
+                        values->cpu_time);
+  uv_mutex_unlock(&top_mutex);
+}
+
+static void top_clear(void) {
+  uv_mutex_lock(&top_mutex);
+  datadog_php_top_k_clear(&top_functions);
+  datadog_php_top_k_clear(&top_stacks);
+  uv_mutex_unlock(&top_mutex);
+}
+
+bool datadog_php_recorder_plugin_top(datadog_php_top_k *functions,
+                                     datadog_php_top_k *stacks) {
+  if (!datadog_php_profiling_recorder_enabled || !have_top) {
+    return false;
+  }
+  uv_mutex_lock(&top_mutex);
+  memcpy(functions, &top_functions, sizeof top_functions);
+  memcpy(stacks, &top_stacks, sizeof top_stacks);
+  uv_mutex_unlock(&top_mutex);
+  return true;
+}
+
+static void upload_stats_add(bool succeeded, const export_outcome *outcome,
+                             uint64_t samples,
+                             const datadog_php_backoff *backoff,
+                             uint64_t retry_in_ns) {
+  if (!have_upload_stats) {
+    return;
+  }
+  uv_mutex_lock(&upload_stats_mutex);
+  ++upload_stats.uploads;
+  upload_stats.failures += !succeeded;
+  upload_stats.last_at = time(NULL);
+  upload_stats.retry_at =
+      retry_in_ns ? upload_stats.last_at + (time_t)(retry_in_ns / 1000000000u)
+                  : 0;
+  upload_stats.consecutive_failures = backoff->failures;
+  upload_stats.last_samples = samples;
+  upload_stats.last = *outcome;
+  uv_mutex_unlock(&upload_stats_mutex);
+}
+
+static void upload_stats_skip(void) {
+  if (!have_upload_stats) {
+    return;
+  }
+  uv_mutex_lock(&upload_stats_mutex);
+  ++upload_stats.skipped;
+  uv_mutex_unlock(&upload_stats_mutex);
+}
+
+/* When the agent can't be reached or is overloaded, uploads back off
+ * exponentially, from one period up to this many periods, with jitter so that
+ * the workers of a host don't all retry at once. While backing off, profiles
+ * aren't even serialized. Instead, the samples of the following periods are
+ * coalesced into the same profile, up to this many periods, after which
+ * they're dropped so the profile doesn't grow without bound. That's twice the
+ * longest backoff, so the profile always gets at least one attempt after the
+ * backoff has reached its maximum before anything is dropped.
+ */
+#define UPLOAD_BACKOFF_MAX_PERIODS 8u
+#define UPLOAD_MAX_COALESCED_PERIODS (2u * UPLOAD_BACKOFF_MAX_PERIODS)
+
+/**
+ * Uploads the profile unless uploads are backing off. Returns whether the
+ * profile should be kept for another attempt, because it wasn't uploaded
+ * and a later attempt may succeed.
+ */
+static bool recorder_upload(datadog_php_backoff *backoff,
+                            const struct ddprof_ffi_Profile *profile,
+                            bool burst, const datadog_php_line_totals *lines,
+                            const datadog_php_endpoint_totals *endpoints,
+                            uint64_t samples) {
+  if (!datadog_php_backoff_allows(backoff, uv_hrtime())) {
+    prof_logger.log_cstr(
+        DATADOG_PHP_LOG_DEBUG,
+        "[Datadog Profiling] Skipped upload while backing off after failures.");
+    upload_stats_skip();
+    return true;
+  }
+
+  export_outcome outcome;
+  bool uploaded = ddprof_ffi_export(&prof_logger, profile, UPLOAD_TIMEOUT_MS,
+                                    burst, lines, endpoints, &outcome);
+  uint64_t retry_in_ns = 0;
+  if (outcome.retryable) {
+    retry_in_ns = datadog_php_backoff_failed(backoff, uv_hrtime());
+
+    char buffer[128];
+    int len = snprintf(buffer, sizeof buffer,
+                       "[Datadog Profiling] Backing off uploads for %" PRIu64
+                       " s after %" PRIu32 " consecutive failures.",
+                       retry_in_ns / 1000000000u, backoff->failures);
+    if (len > 0) {
+      size_t n = (size_t)len < sizeof buffer ? (size_t)len : sizeof buffer - 1;
+      datadog_php_string_view message = {n, buffer};
+      prof_logger.log(DATADOG_PHP_LOG_INFO, message);
+    }
+  } else {
+    datadog_php_backoff_succeeded(backoff);
+  }
+  upload_stats_add(uploaded, &outcome, samples, backoff, retry_in_ns);
+  return outcome.retryable;
+}
+
 void datadog_php_recorder_plugin_main(void) {
   if (period.value < 0) {
     // widest i64 is -9223372036854775808 (20 chars)
@@ -438,16 +1165,31 @@ void datadog_php_recorder_plugin_main(void) {
   const uint64_t period_val = (uint64_t)period.value;
   datadog_php_receiver *receiver = &channel.receiver;
   struct ddprof_ffi_Profile *profile = profile_new();
-  if (!profile) {
+  struct ddprof_ffi_Profile *burst_profile = profile_new();
+  if (!profile || !burst_profile) {
     const char *msg =
         "[Datadog Profiling] Failed to create profile. Samples will not be collected.";
     prof_logger.log_cstr(DATADOG_PHP_LOG_ERROR, msg);
+    if (profile) {
+      ddprof_ffi_Profile_free(profile);
+    }
+    if (burst_profile) {
+      ddprof_ffi_Profile_free(burst_profile);
+    }
     return;
   } else {
     const char *msg = "[Datadog Profiling] Recorder online.";
     prof_logger.log_cstr(DATADOG_PHP_LOG_DEBUG, msg);
   }
 
+  datadog_php_backoff backoff;
+  datadog_php_backoff_ctor(&backoff, period_val,
+                           period_val * UPLOAD_BACKOFF_MAX_PERIODS,
+                           uv_hrtime() ^ (uint64_t)uv_os_getpid());
+
+  uint64_t burst_sample_count = 0;
+  uint64_t pending_sample_count = 0; // including coalesced periods
+  uint32_t coalesced_periods = 0;
   while (datadog_php_profiling_recorder_enabled) {
     uint64_t sample_count = 0;
     uint64_t sleep_for_nanos = period_val;
@@ -458,13 +1200,61 @@ void datadog_php_recorder_plugin_main(void) {
         // an empty message can be sent, such as when we're shutting down
         if (message) {
           datadog_php_recorder_add(profile, message);
+          endpoint_totals_add(message);
+          if (line_hotspots_enabled) {
+            line_totals_add(message);
+          }
+          if (have_top) {
+            top_add(message);
+          }
+          if (message->burst) {
+            /* The profile's start time is when it was last reset, so reset
+             * it when a burst begins for the upload to cover the burst only.
+             */
+            if (!burst_sample_count) {
+              (void)ddprof_ffi_Profile_reset(burst_profile);
+            }
+            datadog_php_recorder_add(burst_profile, message);
+            ++burst_sample_count;
+          }
           free(message);
           ++sample_count;
+          atomic_fetch_add_explicit(&samples_recorded, 1,
+                                    memory_order_relaxed);
+        }
+      }
+
+      /* Upload the burst profile as soon as the burst is over rather than at
+       * the end of the period, as someone is likely waiting for it.
+       */
+      uint64_t now = uv_hrtime();
+      uint64_t burst_until = datadog_php_profiling_burst_until;
+      bool burst_over = burst_sample_count && now >= burst_until;
+      if (burst_over && datadog_php_backoff_allows(&backoff, now)) {
+        /* Bursts are one-offs, so after waiting for the backoff they get one
+         * attempt and aren't kept for another.
+         */
+        if (recorder_upload(&backoff, burst_profile, true, NULL, NULL,
+                            burst_sample_count)) {
+          prof_logger.log_cstr(
+              DATADOG_PHP_LOG_WARN,
+              "[Datadog Profiling] Dropped a burst profile which couldn't be uploaded.");
         }
+        burst_sample_count = 0;
+        burst_over = false;
       }
+
       uint64_t duration = instant_elapsed(before);
       sleep_for_nanos = duration < period_val ? period_val - duration : 0;
       // protect against underflow
+      if (burst_sample_count && !burst_over &&
+          burst_until - now < sleep_for_nanos) {
+        sleep_for_nanos = burst_until - now;
+      }
+      // a finished burst waits for the backoff, but not for the period
+      if (burst_over && backoff.retry_at - now < sleep_for_nanos) {
+        sleep_for_nanos = backoff.retry_at - now;
+      }
     } while (datadog_php_profiling_recorder_enabled && sleep_for_nanos);
 
     /* If no samples have been collected, then don't report the profile. Some
@@ -477,25 +1267,140 @@ void datadog_php_recorder_plugin_main(void) {
      * the profiles of interest aren't being chosen, so it essentially shows
      * no data, despite there being data.
      */
-    if (sample_count) {
-      ddprof_ffi_export(&prof_logger, profile, UPLOAD_TIMEOUT_MS);
+    pending_sample_count += sample_count;
+    bool keep = false;
+    if (pending_sample_count) {
+      keep = recorder_upload(&backoff, profile, false,
+                             line_hotspots_enabled ? &line_totals : NULL,
+                             &endpoint_totals, pending_sample_count);
     } else {
       const char *msg = "[Datadog Profiling] No profiles to upload.";
       prof_logger.log_cstr(DATADOG_PHP_LOG_INFO, msg);
     }
-    (void)ddprof_ffi_Profile_reset(profile);
+    label_sets_recycle();
+
+    if (keep && ++coalesced_periods >= UPLOAD_MAX_COALESCED_PERIODS) {
+      char buffer[128];
+      int len = snprintf(buffer, sizeof buffer,
+                         "[Datadog Profiling] Dropped %" PRIu64
+                         " samples which couldn't be uploaded.",
+                         pending_sample_count);
+      if (len > 0) {
+        size_t n =
+            (size_t)len < sizeof buffer ? (size_t)len : sizeof buffer - 1;
+        datadog_php_string_view message = {n, buffer};
+        prof_logger.log(DATADOG_PHP_LOG_WARN, message);
+      }
+      keep = false;
+    }
+    if (!keep) {
+      datadog_php_line_totals_clear(&line_totals);
+      datadog_php_endpoint_totals_clear(&endpoint_totals);
+      if (have_top) {
+        top_clear();
+      }
+      (void)ddprof_ffi_Profile_reset(profile);
+      pending_sample_count = 0;
+      coalesced_periods = 0;
+    }
   }
 
+  ddprof_ffi_Profile_free(burst_profile);
   ddprof_ffi_Profile_free(profile);
   receiver->dtor(receiver);
 }
 
+// The keys of the labels which the profiler adds itself.
+static const datadog_php_string_view reserved_label_keys[] = {
+    DATADOG_PHP_STRING_VIEW_LITERAL("thread id"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("local root span id"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("span id"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("gc collected"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("gc roots"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("fiber id"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("end_timestamp_ns"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("trace endpoint"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("wait reason"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("opcode"),
+    DATADOG_PHP_STRING_VIEW_LITERAL("exception type"),
+};
+
+datadog_php_set_label_result
+datadog_php_recorder_plugin_set_label(datadog_php_string_view key,
+                                      datadog_php_string_view value) {
+  if (!datadog_php_profiling_recorder_enabled || !have_label_sets) {
+    return DATADOG_PHP_SET_LABEL_DISABLED;
+  }
+
+  size_t n_reserved = sizeof reserved_label_keys / sizeof *reserved_label_keys;
+  for (size_t i = 0; i != n_reserved; ++i) {
+    if (datadog_php_string_view_equal(key, reserved_label_keys[i])) {
+      return DATADOG_PHP_SET_LABEL_RESERVED;
+    }
+  }
+
+  uv_mutex_lock(&label_sets_mutex);
+  datadog_php_label_sets *sets = label_set_refresh();
+  datadog_php_label_set set = {0};
+  const datadog_php_label_set *current =
+      datadog_php_label_sets_get(sets, label_set_id);
+  if (current) {
+    set = *current;
+  }
+
+  datadog_php_set_label_result result = DATADOG_PHP_SET_LABEL_OK;
+  uint32_t id;
+  if (!datadog_php_label_set_put(&set, key, value)) {
+    result = DATADOG_PHP_SET_LABEL_TOO_MANY_LABELS;
+  } else if (!datadog_php_label_sets_intern(sets, &set, &id)) {
+    label_sets_overflowed = true;
+    result = DATADOG_PHP_SET_LABEL_TOO_MANY_SETS;
+  } else {
+    label_set_id = id;
+  }
+  uv_mutex_unlock(&label_sets_mutex);
+  return result;
+}
+
+bool datadog_php_recorder_plugin_clear_label(datadog_php_string_view key) {
+  if (!datadog_php_profiling_recorder_enabled || !have_label_sets) {
+    return false;
+  }
+  if (!key.len || !label_set_id) {
+    label_set_id = 0;
+    return true;
+  }
+
+  uv_mutex_lock(&label_sets_mutex);
+  datadog_php_label_sets *sets = label_set_refresh();
+  const datadog_php_label_set *current =
+      datadog_php_label_sets_get(sets, label_set_id);
+  if (current) {
+    datadog_php_label_set set = *current;
+    uint32_t id;
+    // A subset of an interned set only fails to intern if the table is full.
+    if (datadog_php_label_set_remove(&set, key)) {
+      if (datadog_php_label_sets_intern(sets, &set, &id)) {
+        label_set_id = id;
+      } else {
+        label_sets_overflowed = true;
+      }
+    }
+  }
+  uv_mutex_unlock(&label_sets_mutex);
+  return true;
+}
+
+void datadog_php_recorder_plugin_deactivate(void) { label_set_id = 0; }
+
 void datadog_php_recorder_plugin_shutdown(zend_extension *extension) {
   (void)extension;
 
   if (!datadog_php_profiling_recorder_enabled)
     return;
 
+  burst_signal_uninstall();
+
   // Disable the plugin before sending as that flag's checked by the receiver.
   datadog_php_profiling_recorder_enabled = false;
 
@@ -516,6 +1421,23 @@ void datadog_php_recorder_plugin_shutdown(zend_extension *extension) {
   }
 
   ddprof_ffi_ProfileExporterV3_delete(exporter);
+
+  if (have_label_sets) {
+    have_label_sets = false;
+    datadog_php_label_sets_dtor(&label_sets[0]);
+    datadog_php_label_sets_dtor(&label_sets[1]);
+    uv_mutex_destroy(&label_sets_mutex);
+  }
+
+  if (have_top) {
+    have_top = false;
+    uv_mutex_destroy(&top_mutex);
+  }
+
+  if (have_upload_stats) {
+    have_upload_stats = false;
+    uv_mutex_destroy(&upload_stats_mutex);
+  }
 }
 
 #define SV(literal)                                                            \
@@ -530,6 +1452,12 @@ static bool recorder_first_activate_helper() {
 
   datadog_php_profiling_cpu_time_enabled =
       config->profiling_experimental_cpu_enabled;
+  line_hotspots_enabled = config->profiling_experimental_line_hotspots_enabled;
+  timeline_enabled = config->profiling_experimental_timeline_enabled;
+  datadog_php_line_totals_ctor(&line_totals);
+  datadog_php_endpoint_totals_ctor(&endpoint_totals);
+  datadog_php_top_k_ctor(&top_functions);
+  datadog_php_top_k_ctor(&top_stacks);
 
   ddprof_ffi_CharSlice family = CHARSLICE_C("php");
   const ddprof_ffi_Vec_tag *tags = &config->tags.tags;
@@ -551,11 +1479,44 @@ static bool recorder_first_activate_helper() {
 
   exporter = exporter_result.ok;
 
+  // The recorder thread reads these, so set them before starting it.
+  have_top = config->profiling_experimental_top_enabled &&
+             uv_mutex_init(&top_mutex) == 0;
+  upload_stats = (upload_summary){0};
+  have_upload_stats = uv_mutex_init(&upload_stats_mutex) == 0;
+  if (uv_mutex_init(&label_sets_mutex) == 0) {
+    atomic_store(&label_sets_epoch, 0);
+    label_sets_overflowed = false;
+    have_label_sets = datadog_php_label_sets_ctor(&label_sets[0],
+                                                  LABEL_SETS_STRINGS_SIZE,
+                                                  label_sets_strings[0]) &&
+                      datadog_php_label_sets_ctor(&label_sets[1],
+                                                  LABEL_SETS_STRINGS_SIZE,
+                                                  label_sets_strings[1]);
+    if (!have_label_sets) {
+      uv_mutex_destroy(&label_sets_mutex);
+    }
+  }
+
   thread_id = &thread_id_v;
   int result = uv_thread_create(
       thread_id, (uv_thread_cb)datadog_php_recorder_plugin_main, NULL);
   if (result != 0) {
     thread_id = NULL;
+    if (have_top) {
+      have_top = false;
+      uv_mutex_destroy(&top_mutex);
+    }
+    if (have_upload_stats) {
+      have_upload_stats = false;
+      uv_mutex_destroy(&upload_stats_mutex);
+    }
+    if (have_label_sets) {
+      have_label_sets = false;
+      datadog_php_label_sets_dtor(&label_sets[0]);
+      datadog_php_label_sets_dtor(&label_sets[1]);
+      uv_mutex_destroy(&label_sets_mutex);
+    }
     ddprof_ffi_ProfileExporterV3_delete(exporter);
     channel.receiver.dtor(&channel.receiver);
     channel.sender.dtor(&channel.sender);
@@ -566,12 +1527,15 @@ static bool recorder_first_activate_helper() {
     prof_logger.log(DATADOG_PHP_LOG_ERROR, msg);
     return false;
   }
+
+  burst_signal_install(config->profiling_experimental_burst_signal);
   return true;
 }
 
 void datadog_php_recorder_plugin_first_activate(
     const datadog_php_profiling_config *config) {
   global_config = config;
+  value_types_ctor(config);
   datadog_php_profiling_recorder_enabled =
       config->profiling_enabled && recorder_first_activate_helper();
 }
@@ -640,7 +1604,7 @@ static void
 datadog_php_recorder_collect(const datadog_php_profiling_config *config,
                              struct ddprof_ffi_Profile *profile) {
   record_msg message = {
-      .record_values = {1, 0, 0},
+      .record_values = {1, 0, 0, 0},
       .context = datadog_profiling_get_profiling_context(),
       .thread_id = (int64_t)uv_thread_self(),
   };
@@ -665,6 +1629,98 @@ datadog_php_recorder_collect(const datadog_php_profiling_config *config,
   datadog_php_recorder_add(profile, &message);
 }
 
+/**
+ * Prints a row for each of the `n` heaviest entries of `top`, with the key in
+ * the first column and its values in the second.
+ */
+static void top_diagnose(const char *header, const datadog_php_top_k *top,
+                         size_t n) {
+  php_info_print_table_colspan_header(2, header);
+
+  const datadog_php_top_k_entry *entries[DATADOG_PHP_TOP_K_CAPACITY];
+  size_t len = datadog_php_top_k_heaviest(top, n, entries);
+  if (!len) {
+    datadog_profiling_info_diagnostics_row("(none)", "");
+  }
+  for (size_t i = 0; i != len; ++i) {
+    const datadog_php_top_k_entry *entry = entries[i];
+    char key[DATADOG_PHP_TOP_K_KEY_CAPACITY + 1];
+    memcpy(key, entry->key, entry->key_len);
+    key[entry->key_len] = '\0';
+
+    char values[96];
+    (void)snprintf(values, sizeof values,
+                   "%" PRId64 " samples, %.1f ms cpu time, %.1f ms wall time",
+                   entry->count, entry->cpu_time / 1e6,
+                   entry->wall_time / 1e6);
+    datadog_profiling_info_diagnostics_row(key, values);
+  }
+}
+
+/**
+ * Prints the upload statistics which the recorder thread keeps.
+ */
+static void upload_stats_diagnose(void) {
+  uv_mutex_lock(&upload_stats_mutex);
+  upload_summary stats = upload_stats;
+  uv_mutex_unlock(&upload_stats_mutex);
+
+  php_info_print_table_colspan_header(2, "Profiling Upload Statistics");
+
+  char buffer[192];
+  (void)snprintf(buffer, sizeof buffer,
+                 "%" PRIu64 " (%" PRIu64 " failed), %" PRIu64
+                 " skipped while backing off",
+                 stats.uploads, stats.failures, stats.skipped);
+  datadog_profiling_info_diagnostics_row("Uploads", buffer);
+
+  if (stats.retry_at) {
+    double retry_in = difftime(stats.retry_at, time(NULL));
+    (void)snprintf(buffer, sizeof buffer,
+                   "%" PRIu32 " consecutive failures, retrying in %.0f s",
+                   stats.consecutive_failures, retry_in > 0 ? retry_in : 0);
+    datadog_profiling_info_diagnostics_row("Upload Backoff", buffer);
+  } else {
+    datadog_profiling_info_diagnostics_row("Upload Backoff", "(none)");
+  }
+
+  if (stats.uploads) {
+    struct tm tm;
+    char at[32] = "(unknown)";
+    if (gmtime_r(&stats.last_at, &tm)) {
+      (void)strftime(at, sizeof at, "%Y-%m-%dT%H:%M:%SZ", &tm);
+    }
+    (void)snprintf(buffer, sizeof buffer, "%s (%.0f s ago)", at,
+                   difftime(time(NULL), stats.last_at));
+    datadog_profiling_info_diagnostics_row("Last Upload", buffer);
+
+    const export_outcome *last = &stats.last;
+    if (last->code) {
+      (void)snprintf(buffer, sizeof buffer, "HTTP %" PRIu16, last->code);
+    } else {
+      (void)snprintf(buffer, sizeof buffer, "failed: %.*s",
+                     (int)last->error_len, last->error);
+    }
+    datadog_profiling_info_diagnostics_row("Last Upload Status", buffer);
+
+    (void)snprintf(buffer, sizeof buffer, "%.1f", last->latency_ns / 1e6);
+    datadog_profiling_info_diagnostics_row("Last Upload Latency (ms)", buffer);
+    (void)snprintf(buffer, sizeof buffer, "%" PRIu64, last->bytes);
+    datadog_profiling_info_diagnostics_row("Last Upload Size (bytes)", buffer);
+    (void)snprintf(buffer, sizeof buffer, "%" PRIu64, stats.last_samples);
+    datadog_profiling_info_diagnostics_row("Last Upload Samples", buffer);
+  } else {
+    datadog_profiling_info_diagnostics_row("Last Upload", "(none yet)");
+  }
+
+  (void)snprintf(buffer, sizeof buffer, "%" PRIu64,
+                 atomic_load_explicit(&samples_recorded, memory_order_relaxed));
+  datadog_profiling_info_diagnostics_row("Samples Recorded", buffer);
+  (void)snprintf(buffer, sizeof buffer, "%" PRIu64,
+                 atomic_load_explicit(&samples_dropped, memory_order_relaxed));
+  datadog_profiling_info_diagnostics_row("Samples Dropped", buffer);
+}
+
 void datadog_php_recorder_plugin_diagnose(
     const datadog_php_profiling_config *config) {
   const char *yes = "true", *no = "false";
@@ -677,7 +1733,26 @@ void datadog_php_recorder_plugin_diagnose(
   struct ddprof_ffi_Profile *profile = profile_new();
   datadog_profiling_info_diagnostics_row("Can create profiles",
                                          profile ? yes : no);
-  if (datadog_php_profiling_recorder_enabled && profile) {
+
+  datadog_php_top_k *functions = malloc(sizeof *functions);
+  datadog_php_top_k *stacks = malloc(sizeof *stacks);
+  if (functions && stacks &&
+      datadog_php_recorder_plugin_top(functions, stacks)) {
+    top_diagnose("Profiling Top Functions", functions, 10);
+    top_diagnose("Profiling Top Stacks", stacks, 5);
+  }
+  free(stacks);
+  free(functions);
+
+  if (datadog_php_profiling_recorder_enabled && have_upload_stats) {
+    upload_stats_diagnose();
+  }
+
+  /* A live upload blocks for up to the upload timeout, and phpinfo is often
+   * used for health checks, so it's opt-in.
+   */
+  if (datadog_php_profiling_recorder_enabled && profile &&
+      config->profiling_diagnostics_upload_enabled) {
     datadog_php_static_logger logger = {
         .log = upload_log,
         .logv = upload_logv,
@@ -687,7 +1762,8 @@ void datadog_php_recorder_plugin_diagnose(
     datadog_php_recorder_collect(config, profile);
 
     php_info_print_table_colspan_header(2, "Profiling Upload Diagnostics");
-    bool uploaded = ddprof_ffi_export(&logger, profile, UPLOAD_TIMEOUT_MS);
+    bool uploaded = ddprof_ffi_export(&logger, profile, UPLOAD_TIMEOUT_MS,
+                                      false, NULL, NULL, NULL);
     datadog_profiling_info_diagnostics_row("Can upload profiles",
                                            uploaded ? yes : no);
   }
@@ -2,6 +2,8 @@
 #define DATADOG_PHP_RECORDER_PLUGIN_H
 
 #include <Zend/zend_extensions.h>
+#include <components/label_sets/label_sets.h>
+#include <components/top_k/top_k.h>
 #include <config/config.h>
 #include <profiling/context.h>
 #include <stack-collector/stack-collector.h>
@@ -12,6 +14,13 @@
 extern atomic_bool datadog_php_profiling_recorder_enabled;
 extern bool datadog_php_profiling_cpu_time_enabled;
 
+/* While uv_hrtime() is before burst_until, the stack collector ticks every
+ * burst_interval_ms, and samples are also added to a separate burst profile
+ * which is uploaded once the burst is over. 0 means there is no burst.
+ */
+extern _Atomic uint64_t datadog_php_profiling_burst_until;
+extern _Atomic uint32_t datadog_php_profiling_burst_interval_ms;
+
 /* The recorder has two high level responsibilities:
  *  1. Aggregate samples.
  *  2. Export profiles once the configured period has elapsed.
@@ -21,14 +30,101 @@ typedef struct datadog_php_record_values {
   uint64_t count;    // usually 0 or 1
   int64_t wall_time; // wall time in ns since last sample, may be 0
   int64_t cpu_time;  // cpu time in ns since last sample, may be 0
+  int64_t exceptions; // estimated number of exceptions thrown, may be 0
+  int64_t memory_usage; // bytes in use when sampled times count, may be 0
+  int64_t memory_peak_growth; // growth of peak usage in bytes since last sample
 } datadog_php_record_values;
 
+/**
+ * Labels which are specific to some kinds of samples. Strings are copied into
+ * the labels because they need to outlive the PHP request, so they have fixed
+ * capacities and get truncated. Zero-initialize it for "no labels".
+ */
+typedef struct datadog_php_record_labels {
+  bool gc;               // whether this sample is a garbage collection
+  uint32_t gc_collected; // number of values the collection freed
+  uint32_t gc_roots;     // number of possible roots when it began, if known
+
+  uint32_t fiber_id; // object handle of the running fiber, 0 if none
+
+  uint64_t end_timestamp; // uv_hrtime when the sample ended, 0 if not tracked
+
+  // Why the top frame blocks, such as "db". It isn't copied, as it points to
+  // the wait reasons table, which lives until module shutdown.
+  uint8_t wait_reason_len;
+  const char *wait_reason;
+
+  // The opcode the leaf PHP frame is on, such as "ZEND_FETCH_DIM_R". Like the
+  // wait reason it isn't copied, as the VM's opcode names are static.
+  uint8_t opcode_len;
+  const char *opcode;
+
+  uint8_t exception_type_len;
+  char exception_type[127]; // class name of the thrown exception
+
+  uint8_t trace_endpoint_len;
+  char trace_endpoint[127]; // resource of the trace's root span
+} datadog_php_record_labels;
+
+/**
+ * Copies the `len` bytes at `ptr` into the labels' exception type, truncating
+ * it if it doesn't fit.
+ */
+void datadog_php_record_labels_set_exception_type(
+    datadog_php_record_labels *labels, size_t len, const char *ptr);
+
+/**
+ * Copies the endpoint of the active trace, if there is one, into the labels.
+ * Like datadog_profiling_get_profiling_endpoint, only call it on a PHP thread.
+ */
+void datadog_php_record_labels_set_trace_endpoint(
+    datadog_php_record_labels *labels);
+
 __attribute__((nonnull)) bool datadog_php_recorder_plugin_record(
     datadog_php_record_values record_values, int64_t tid,
-    const datadog_php_stack_sample *sample, ddtrace_profiling_context context);
+    const datadog_php_stack_sample *sample, ddtrace_profiling_context context,
+    const datadog_php_record_labels *labels);
+
+/**
+ * Starts a burst of `seconds` with samples every `interval_ms`, replacing any
+ * burst in progress. Returns false if the recorder isn't enabled. This is
+ * async-signal-safe.
+ */
+bool datadog_php_recorder_plugin_burst(uint32_t seconds, uint32_t interval_ms);
+
+typedef enum datadog_php_set_label_result_e {
+  DATADOG_PHP_SET_LABEL_OK,
+  DATADOG_PHP_SET_LABEL_DISABLED,        // the recorder isn't enabled
+  DATADOG_PHP_SET_LABEL_RESERVED,        // the profiler uses the key itself
+  DATADOG_PHP_SET_LABEL_TOO_MANY_LABELS, // the request has too many labels
+  DATADOG_PHP_SET_LABEL_TOO_MANY_SETS,   // the process has too many sets
+} datadog_php_set_label_result;
+
+/**
+ * Sets the custom label `key` to `value` on the samples which this thread
+ * records until the end of the request. The strings are copied.
+ */
+datadog_php_set_label_result
+datadog_php_recorder_plugin_set_label(datadog_php_string_view key,
+                                      datadog_php_string_view value);
+
+/**
+ * Removes the custom label `key`, or all of them if `key` is empty. Returns
+ * false if the recorder isn't enabled.
+ */
+bool datadog_php_recorder_plugin_clear_label(datadog_php_string_view key);
+
+/**
+ * Copies the running summaries of the heaviest leaf functions and stacks of
+ * the current period. Returns false, leaving them untouched, if the recorder or
+ * the summaries aren't enabled.
+ */
+bool datadog_php_recorder_plugin_top(datadog_php_top_k *functions,
+                                     datadog_php_top_k *stacks);
 
 void datadog_php_recorder_plugin_first_activate(
     const datadog_php_profiling_config *config);
+void datadog_php_recorder_plugin_deactivate(void);
 void datadog_php_recorder_plugin_shutdown(zend_extension *extension);
 
 void datadog_php_recorder_plugin_diagnose(
@@ -1,24 +1,79 @@
+// for dladdr and REG_RIP on glibc; php_config.h may define it the same way
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+
 #include "stack_collector_plugin.h"
 
 #include "../../context.h"
 #include "../log_plugin/log_plugin.h"
 #include "../recorder_plugin/recorder_plugin.h"
 #include <components/clocks/clocks.h>
+#include <components/prng/prng.h>
+#include <components/wait_reasons/wait_reasons.h>
 #include <stack-collector/stack-collector.h>
 
 #include <Zend/zend_execute.h>
+#include <Zend/zend_vm_opcodes.h>
+#include <dlfcn.h>
 #include <errno.h>
+#include <php.h>
 #include <php_config.h>
 #include <stdatomic.h>
 #include <uv.h>
 
+// must come after php.h
+#include <ext/standard/php_random.h>
+
+#if defined(__linux__) && (defined(__x86_64__) || defined(__aarch64__))
+#define NATIVE_FRAMES_SUPPORTED 1
+#include <link.h>
+#include <signal.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <ucontext.h>
+#include <unistd.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+#else
+#define NATIVE_FRAMES_SUPPORTED 0
+#endif
+
+#if PHP_VERSION_ID >= 80100
+#include <Zend/zend_fibers.h>
+#include <Zend/zend_observer.h>
+#endif
+
 typedef datadog_php_stack_sample stack_sample_t;
 typedef datadog_php_stack_sample_frame stack_sample_frame_t;
 typedef datadog_php_stack_sample_iterator stack_sample_iterator_t;
 
+struct stack_collector_thread_globals;
+
+/* A single collector thread serves every PHP thread in the process, which is
+ * one thread for NTS builds and possibly many for ZTS builds. It's started by
+ * the first request and runs until module shutdown.
+ */
 struct globals_s {
   bool have_thread;
   pthread_t thread;
+  uv_loop_t uv_loop;
+  uv_timer_t uv_timer;
+  uv_async_t stop_async;
+
+  /* The PHP threads which are currently serving a request. The collector
+   * thread holds the mutex while it ticks them, so a thread's globals stay
+   * valid until it's been removed. Remote walks are slow, so the collector
+   * releases the mutex during them and marks the thread it's walking instead;
+   * that thread waits on the condition for the walk to end before it removes
+   * itself, while the others come and go as usual.
+   */
+  uv_mutex_t registry_mutex;
+  uv_cond_t registry_cond;
+  struct stack_collector_thread_globals *registry;
+  struct stack_collector_thread_globals *walking;
 
   void (*prev_interrupt_function)(zend_execute_data *);
   void (*prev_execute_internal)(zend_execute_data *, zval *);
@@ -29,13 +84,188 @@ static struct globals_s globals;
 ZEND_TLS int64_t zend_thread_id;
 static _Atomic bool enabled;
 
+/* The engine links the bottom of a fiber's stack to the frame which resumed
+ * it, so by default a fiber's samples include the stack of its resumer. When
+ * this is false, the walk stops at the bottom of the fiber's stack instead.
+ */
+static bool stitch_fibers;
+
+/* When a thread spends several ticks inside of one internal call, such as
+ * sleep or curl_exec, the VM cannot service the interrupt until the call
+ * returns. When this is true, such a sample is split into one sample per tick
+ * which ends at the time the tick fired, instead of one big sample.
+ */
+static bool split_samples;
+
+/* When this is true, the collector thread walks the PHP thread's stack itself
+ * instead of interrupting the VM, so the PHP thread never runs profiler code.
+ */
+static bool remote_sampling;
+
+/* Threads are ticked at the base interval. Once a request has been running
+ * for longer than the slow request threshold, its thread is ticked at the slow
+ * request interval instead, until the request ends. A threshold of 0 disables
+ * this. During a burst, all threads are ticked at least as often as the burst
+ * interval.
+ */
+#define BASE_INTERVAL_MS 10
+#define SLOW_REQUEST_INTERVAL_MS 1
+static uint64_t slow_request_threshold_ns;
+
+/* When this is true, a thread whose trace has been kept by the tracer is
+ * ticked at the kept trace interval, so the traces which people look at have
+ * enough samples for code hotspots. Kept traces are a lot more common than
+ * slow requests, so the boost is milder.
+ */
+#define KEPT_TRACE_INTERVAL_MS 2
+static bool kept_trace_boost;
+
+/* When this is true, samples whose top frame is a known blocking internal
+ * function are labeled with why it blocks. The table is only read after
+ * first activate, so it needs no locking.
+ */
+static bool wait_reason_enabled;
+static datadog_php_wait_reasons wait_reasons;
+
+/* When this is true, a timer which counts the PHP thread's cpu time signals
+ * the thread every BASE_INTERVAL_MS of cpu time. If the thread is in an
+ * internal call then, the handler walks the native stack above the call by
+ * its frame pointers. The sample which is taken when the call returns is then
+ * recorded once per stack which was captured, with the native frames on top.
+ * The timer doesn't run while the thread is blocked, so blocking calls such as
+ * sleep are hardly ever interrupted by it.
+ */
+static bool native_frames;
+
+// When this is true, samples are labeled with the opcode of the leaf PHP frame.
+static bool line_hotspots;
+
+/* When this is true, samples also read the memory manager's usage. It's only
+ * safe to do so on the PHP thread, so remote samples don't have it.
+ */
+static bool memory_enabled;
+
+/* When this is true, the time around the PHP code of a request is recorded
+ * too: from the end of the previous request as [idle], until the VM first
+ * checks for interrupts as [request startup], and after the last sample as
+ * [request shutdown]. Samples taken during shutdown, such as of shutdown
+ * functions and destructors, get [request shutdown] as their root frame.
+ * Remote samples don't move last_event_at, so they only get [idle].
+ */
+static bool request_phases;
+
+/* When this is true, requests are only sampled inside of the regions which
+ * they start with datadog_profiling_start_region. The thread is registered
+ * with the collector only while it's in a region, so there's no overhead
+ * outside of them. The time around the request's PHP code isn't recorded.
+ */
+static bool regions_only;
+
+static const datadog_php_string_view idle_frame =
+    DATADOG_PHP_STRING_VIEW_LITERAL("[idle]");
+static const datadog_php_string_view request_startup_frame =
+    DATADOG_PHP_STRING_VIEW_LITERAL("[request startup]");
+static const datadog_php_string_view request_shutdown_frame =
+    DATADOG_PHP_STRING_VIEW_LITERAL("[request shutdown]");
+
+/* Only this share of workers, and of requests within them, arm the stack
+ * collector; it's in parts per million. The values of their samples are
+ * scaled up by the inverse so that totals across the fleet stay unbiased.
+ */
+#define SAMPLE_RATE_ONE UINT32_C(1000000)
+static uint32_t request_sample_rate;
+static uint32_t sample_rate; // request_sample_rate * the worker sample rate
+static bool worker_sampled;
+ZEND_TLS bool request_sampled;
+ZEND_TLS bool have_prng;
+ZEND_TLS datadog_php_prng prng;
+
+// Returns a uniformly distributed number in [0, SAMPLE_RATE_ONE).
+static uint32_t sample_rate_roll(void) {
+  if (UNEXPECTED(!have_prng)) {
+    uint64_t seed;
+    if (php_random_bytes_silent(&seed, sizeof seed) != SUCCESS) {
+      seed = uv_hrtime() ^ (uint64_t)uv_thread_self();
+    }
+    datadog_php_prng_ctor(&prng, seed);
+    have_prng = true;
+  }
+  return (uint32_t)datadog_php_prng_below(&prng, SAMPLE_RATE_ONE);
+}
+
+static bool stack_collector_thread_start(void);
+static void stack_collector_install_execute_internal(void);
+static bool stack_collector_native_startup(void);
+static void stack_collector_native_shutdown(void);
+#if NATIVE_FRAMES_SUPPORTED
+static void stack_collector_native_timer_start(void);
+static void stack_collector_native_timer_stop(void);
+#endif
+static void stack_collector_record_phase(datadog_php_string_view name,
+                                         uv_hrtime_t *wall_since,
+                                         struct timespec *cpu_since);
+static void stack_collector_idle_begin(void);
+
 void datadog_php_stack_collector_first_activate(
     datadog_php_profiling_config *config) {
   enabled = config->profiling_enabled;
   if (!config->profiling_enabled)
     return;
 
-  zend_thread_id = (int64_t)uv_thread_self();
+  stitch_fibers = config->profiling_fiber_stitching_enabled;
+  split_samples = config->profiling_experimental_split_samples_enabled;
+  slow_request_threshold_ns =
+      config->profiling_experimental_slow_request_threshold_ms *
+      UINT64_C(1000000);
+  kept_trace_boost = config->profiling_experimental_kept_trace_boost_enabled;
+
+  line_hotspots = config->profiling_experimental_line_hotspots_enabled;
+  memory_enabled = config->profiling_experimental_memory_enabled;
+  request_phases = config->profiling_experimental_request_phases_enabled;
+  regions_only = config->profiling_experimental_regions_only;
+  wait_reason_enabled = config->profiling_experimental_wait_reason_enabled;
+  if (wait_reason_enabled) {
+    datadog_php_wait_reasons_default_ctor(&wait_reasons);
+    datadog_php_string_view rules = {
+        config->profiling_experimental_wait_reasons.len,
+        config->profiling_experimental_wait_reasons.ptr,
+    };
+    if (!datadog_php_wait_reasons_parse(&wait_reasons, rules)) {
+      prof_logger.log_cstr(
+          DATADOG_PHP_LOG_WARN,
+          "[Datadog Profiling] Some of DD_PROFILING_EXPERIMENTAL_WAIT_REASONS could not be used; check its format.");
+    }
+  }
+
+  uint32_t worker_sample_rate = config->profiling_worker_sample_rate;
+  request_sample_rate = config->profiling_request_sample_rate;
+  worker_sampled = worker_sample_rate == SAMPLE_RATE_ONE ||
+                   sample_rate_roll() < worker_sample_rate;
+  sample_rate = (uint32_t)((uint64_t)worker_sample_rate * request_sample_rate /
+                           SAMPLE_RATE_ONE);
+  if (!sample_rate) {
+    sample_rate = 1;
+  }
+
+  remote_sampling = false;
+  if (config->profiling_experimental_remote_sampling_enabled) {
+    remote_sampling = datadog_php_stack_collect_remote_available();
+    if (!remote_sampling) {
+      prof_logger.log_cstr(
+          DATADOG_PHP_LOG_WARN,
+          "[Datadog Profiling] Remote sampling is not available on this platform or in this process; falling back to interrupts.");
+    }
+  }
+
+  native_frames = false;
+  if (config->profiling_experimental_native_frames_enabled) {
+    native_frames = !remote_sampling && stack_collector_native_startup();
+    if (!native_frames) {
+      prof_logger.log_cstr(
+          DATADOG_PHP_LOG_WARN,
+          "[Datadog Profiling] Native frames are not available on this platform, with remote sampling, or while another handler uses their signal.");
+    }
+  }
 
   if (config->profiling_experimental_cpu_enabled) {
     datadog_php_cpu_time_result now = datadog_php_cpu_time_now();
@@ -51,6 +281,11 @@ void datadog_php_stack_collector_first_activate(
       return;
     }
   }
+
+  enabled = stack_collector_thread_start();
+  if (enabled) {
+    stack_collector_install_execute_internal();
+  }
 }
 
 /* By default, no interrupt function is set. Other extensions may set one, and
@@ -67,55 +302,302 @@ datadog_php_stack_collector_interrupt_function_helper(zend_execute_data *);
 static void datadog_php_stack_collector_execute_internal(zend_execute_data *,
                                                          zval *retval);
 
+#if PHP_VERSION_ID >= 80100
+static void datadog_php_stack_collector_fiber_switch(zend_fiber_context *from,
+                                                     zend_fiber_context *to);
+#endif
+
 void datadog_php_stack_collector_startup(zend_extension *extension) {
   (void)extension;
 
-#if !defined(ZTS)
+  globals.have_thread = false;
+  globals.registry = NULL;
+  globals.walking = NULL;
+  (void)uv_mutex_init(&globals.registry_mutex);
+  (void)uv_cond_init(&globals.registry_cond);
+
   globals.prev_interrupt_function = zend_interrupt_function;
   zend_interrupt_function = globals.prev_interrupt_function
       ? datadog_php_stack_collector_interrupt_function_helper
       : datadog_php_stack_collector_interrupt_function;
 
-  globals.prev_execute_internal =
-      zend_execute_internal ? zend_execute_internal : execute_internal;
-  zend_execute_internal = datadog_php_stack_collector_execute_internal;
+  globals.prev_execute_internal = NULL;
+
+#if PHP_VERSION_ID >= 80100
+  zend_observer_fiber_switch_register(datadog_php_stack_collector_fiber_switch);
 #endif
 }
 
 typedef uint64_t uv_hrtime_t;
 
+/* The number of tick times kept per thread. Ticks beyond this are merged into
+ * the last sample, which also keeps a single long call from flooding the
+ * recorder's channel.
+ */
+#define TICK_TIMES_CAPACITY 32
+
+// Requests rarely have more than a handful of spans open at once.
+#define SPAN_CPU_CAPACITY 16
+
+// Direct-mapped caches; see wait_reason_of and native_symbol_of.
+#define WAIT_REASON_CACHE_CAPACITY 64
+#define NATIVE_SYMBOL_CACHE_CAPACITY 128
+
+/* The number of native stacks kept per thread between samples; later ones
+ * replace the oldest. A stack is walked up to the frame of our
+ * zend_execute_internal hook, for at most this many frames and bytes.
+ */
+#define NATIVE_STACKS_CAPACITY 8
+#define NATIVE_STACK_MAX_DEPTH 64
+#define NATIVE_STACK_MAX_SPAN ((uintptr_t)1 << 20)
+
+/* Converts `interval_us`, the sum of the intervals which the ticks being
+ * accounted were made at, into the number of base interval ticks they stand
+ * for, scaled up by the inverse of the sample rate, carrying the remainder
+ * over to the next call. As each tick brings its own interval, this keeps the
+ * sample count unbiased when a thread is ticked more often, when its interval
+ * changes while ticks are pending, or when only some requests are sampled.
+ */
+static uint64_t weighted_count(uint64_t interval_us, uint64_t *remainder) {
+  uint64_t den = (uint64_t)BASE_INTERVAL_MS * 1000u * sample_rate;
+  uint64_t total = interval_us * SAMPLE_RATE_ONE + *remainder;
+  *remainder = total % den;
+  return total / den;
+}
+
+/* Scales up the measured values by the inverse of the sample rate. They don't
+ * depend on the interval, as they're measured rather than counted.
+ */
+static void weight_times(datadog_php_record_values *values) {
+  if (sample_rate != SAMPLE_RATE_ONE) {
+    double scale = (double)SAMPLE_RATE_ONE / sample_rate;
+    values->wall_time = (int64_t)(values->wall_time * scale);
+    values->cpu_time = (int64_t)(values->cpu_time * scale);
+    values->exceptions = (int64_t)(values->exceptions * scale);
+    values->memory_peak_growth = (int64_t)(values->memory_peak_growth * scale);
+  }
+}
+
+bool datadog_php_stack_collector_request_sampled(void) {
+  return request_sampled;
+}
+
+void datadog_php_stack_collector_weight(datadog_php_record_values *values) {
+  weight_times(values);
+}
+
 /**
- * We need to pass the address of the VM interrupt (or the whole globals) to the
- * interrupt function. We also need to pass our own interrupt flag, as other
+ * The collector thread needs the address of each PHP thread's VM interrupt (or
+ * the whole executor globals). We also need our own interrupt counter, as other
  * extensions can trigger interrupts as well, and we should only handle our own.
- *
- * The sigevent struct can only pass an integer or a single pointer, so we make
- * a composite struct to hold everything we need.
+ * Each PHP thread links its own into the registry while it serves a request.
  */
 typedef struct stack_collector_thread_globals {
+  struct stack_collector_thread_globals *prev, *next;
   _Atomic uint32_t interrupt_count;
+  /* The times of the pending ticks, written by the collector thread. These
+   * are best-effort: a slot may be read before it's written, so readers must
+   * validate them.
+   */
+  _Atomic uv_hrtime_t tick_times[TICK_TIMES_CAPACITY];
   zend_executor_globals *eg;
-  bool have_uv_loop;
-  uv_loop_t uv_loop;
-  uv_timer_t uv_timer;
-  uv_async_t stop_async;
+
+  /* The collector thread owns the schedule. Along with each tick, it adds the
+   * interval the tick was made at to pending_us, which the PHP thread takes
+   * with the ticks to weight its samples.
+   */
+  uv_hrtime_t request_started_at;
+  uv_hrtime_t next_tick_at;
+  _Atomic uint64_t pending_us;
+  uint64_t count_remainder;
+  _Atomic bool trace_kept; // published by the PHP thread when it samples
+
+  /* How many regions the PHP thread is in, and the interval the outermost of
+   * them asked for, or 0 for the usual one. Whether the thread is in the
+   * registry is tracked as it depends on the regions when only they're
+   * sampled.
+   */
+  uint32_t region_depth;
+  _Atomic uint32_t region_interval_ms;
+  bool registered;
+
   uv_hrtime_t last_event_at;
   struct timespec last_cpu;
   stack_sample_t sample; // this is big!
+
+  /* These are only used by the collector thread when remote sampling. Ticks
+   * and time accumulate in here until a walk succeeds.
+   */
+  pthread_t php_thread;
+  int64_t php_thread_id; // zend_thread_id is thread-local, so copy it
+  uint64_t remote_pending_us;
+  uint64_t remote_count_remainder;
+  uv_hrtime_t remote_last_at;
+  struct timespec remote_last_cpu;
+  stack_sample_t remote_sample; // this is big too!
+
+  /* The cpu time of the request's spans, excluding their child spans, for the
+   * tracer to read when they close. The cpu time since span_cpu_last goes to
+   * the span which is active when it's next accounted, which is at each sample
+   * and when the tracer reads it. When full, the oldest entry is replaced.
+   */
+  struct timespec span_cpu_last;
+  struct {
+    uint64_t span_id; // 0 if the entry is free
+    int64_t cpu_time;
+  } span_cpu[SPAN_CPU_CAPACITY];
+  uint32_t span_cpu_next;
+
+  size_t memory_peak; // the peak usage as of the last sample
+
+  // When the thread became idle, if request phases are enabled; 0 if unknown.
+  uv_hrtime_t idle_since;
+  struct timespec idle_since_cpu;
+  bool in_startup; // whether the request hasn't been interrupted yet
+
+  struct {
+    const zend_function *func; // NULL if the entry is free
+    datadog_php_string_view reason;
+  } wait_reason_cache[WAIT_REASON_CACHE_CAPACITY];
+
+#if NATIVE_FRAMES_SUPPORTED
+  /* The cpu timer's signal handler interrupts this thread, so it only reads
+   * and writes these while native_reading is 0. The boundary is the frame of
+   * the innermost zend_execute_internal hook on the current stack, or 0 if
+   * unknown; native stacks are only walked up to it.
+   */
+  timer_t native_timer;
+  bool have_native_timer;
+  volatile sig_atomic_t native_reading;
+  volatile uintptr_t native_boundary;
+  uint32_t native_captures; // may exceed the capacity
+  struct native_stack_s {
+    const zend_execute_data *execute_data; // the internal call's frame
+    const zend_function *func;
+    uint16_t depth;
+    uintptr_t addresses[NATIVE_STACK_MAX_DEPTH]; // leaf first
+  } native_stacks[NATIVE_STACKS_CAPACITY];
+
+  struct native_symbol_s {
+    uintptr_t address;  // 0 if the entry is free
+    const char *object; // NULL if it couldn't be resolved
+    const char *name;   // NULL if the symbol isn't exported
+    uintptr_t name_address;
+    uint64_t mapping_start;
+    uint64_t mapping_limit;
+    uint64_t mapping_offset;
+  } native_symbol_cache[NATIVE_SYMBOL_CACHE_CAPACITY];
+#endif
 } stack_collector_thread_globals;
 
 _Thread_local stack_collector_thread_globals thread_globals;
 
+/* The registry is a doubly-linked list so that a thread can remove itself
+ * without searching. Only call these while holding the registry mutex.
+ */
+static void registry_add(stack_collector_thread_globals *thread) {
+  thread->prev = NULL;
+  thread->next = globals.registry;
+  if (globals.registry) {
+    globals.registry->prev = thread;
+  }
+  globals.registry = thread;
+}
+
+static void registry_remove(stack_collector_thread_globals *thread) {
+  if (thread->prev) {
+    thread->prev->next = thread->next;
+  } else {
+    globals.registry = thread->next;
+  }
+  if (thread->next) {
+    thread->next->prev = thread->prev;
+  }
+  thread->prev = thread->next = NULL;
+}
+
+typedef struct pending_ticks_s {
+  uint32_t count;
+  uint64_t interval_us; // the sum of the ticks' intervals
+} pending_ticks;
+
+/* Takes the current thread's pending ticks. The collector thread adds a tick's
+ * interval before the tick itself, so the intervals of the ticks which are
+ * taken are always there. If a tick is being made meanwhile, its interval may
+ * be taken early, and then the tick itself counts for nothing later.
+ */
+static pending_ticks stack_collector_take_ticks(void) {
+  pending_ticks ticks = {
+      .count = atomic_exchange(&thread_globals.interrupt_count, 0),
+  };
+  if (ticks.count) {
+    ticks.interval_us = atomic_exchange(&thread_globals.pending_us, 0);
+  }
+  return ticks;
+}
+
+static void stack_collector_register(void) {
+  uv_mutex_lock(&globals.registry_mutex);
+  registry_add(&thread_globals);
+  uv_mutex_unlock(&globals.registry_mutex);
+  thread_globals.registered = true;
+
+#if NATIVE_FRAMES_SUPPORTED
+  if (native_frames) {
+    stack_collector_native_timer_start();
+  }
+#endif
+}
+
+static void stack_collector_unregister(void) {
+  if (!thread_globals.registered) {
+    return;
+  }
+  uv_mutex_lock(&globals.registry_mutex);
+  while (globals.walking == &thread_globals) {
+    uv_cond_wait(&globals.registry_cond, &globals.registry_mutex);
+  }
+  registry_remove(&thread_globals);
+  uv_mutex_unlock(&globals.registry_mutex);
+  thread_globals.registered = false;
+
+#if NATIVE_FRAMES_SUPPORTED
+  stack_collector_native_timer_stop();
+#endif
+
+  // Drop ticks which arrived after the last sample so they're not counted
+  // towards the next request. No more can arrive now.
+  (void)stack_collector_take_ticks();
+  atomic_store(&thread_globals.pending_us, 0);
+}
+
 void datadog_php_stack_collector_deactivate(void) {
-  if (!enabled)
+  if (!request_sampled) {
+    if (enabled && request_phases) {
+      stack_collector_idle_begin();
+    }
     return;
+  }
 
-  if (thread_globals.have_uv_loop) {
-    // return code is not documented; quick scan of src on unix only returns 0
-    (void)uv_async_send(&thread_globals.stop_async);
+  if (request_phases) {
+    if (!remote_sampling && !regions_only) {
+      stack_collector_record_phase(request_shutdown_frame,
+                                   &thread_globals.last_event_at,
+                                   &thread_globals.last_cpu);
+    }
+    stack_collector_idle_begin();
   }
 
+  stack_collector_unregister();
+}
+
+void datadog_php_stack_collector_shutdown(zend_extension *extension) {
+  (void)extension;
+
   if (globals.have_thread) {
+    // return code is not documented; quick scan of src on unix only returns 0
+    (void)uv_async_send(&globals.stop_async);
+
     enum {
       PTHREAD_JOIN_SUCCESS = 0,
       PTHREAD_JOIN_EDEADLK = EDEADLK,
@@ -137,10 +619,108 @@ void datadog_php_stack_collector_deactivate(void) {
   }
 
   globals.have_thread = false;
+  uv_cond_destroy(&globals.registry_cond);
+  uv_mutex_destroy(&globals.registry_mutex);
+
+  if (native_frames) {
+    stack_collector_native_shutdown();
+    native_frames = false;
+  }
 }
 
-static void datadog_php_stack_collector_collect_cb(uv_timer_t *handle) {
-  stack_collector_thread_globals *remote_globals = handle->data;
+/* Samples the PHP thread from the collector thread. The trace context and the
+ * custom labels are only reachable through the PHP thread's own thread-local
+ * state, so these samples have neither span ids nor custom labels; the
+ * recorder reads the labels from the collector thread, which never has any.
+ * Walks which raced with the PHP thread are discarded. This runs without the
+ * registry mutex, while the thread is marked as being walked.
+ */
+static void
+stack_collector_remote_sample(stack_collector_thread_globals *remote_globals,
+                              uint32_t interval_ms) {
+  remote_globals->remote_pending_us += interval_ms * UINT64_C(1000);
+  if (!datadog_php_profiling_recorder_enabled) {
+    return;
+  }
+
+  stack_sample_t *sample = &remote_globals->remote_sample;
+  zend_execute_data **current_execute_data =
+      &remote_globals->eg->current_execute_data;
+  if (!datadog_php_stack_collect_remote(current_execute_data, sample) ||
+      !sample->depth) {
+    return;
+  }
+
+  uv_hrtime_t now = uv_hrtime();
+  datadog_php_record_values values = {
+      .count = weighted_count(remote_globals->remote_pending_us,
+                              &remote_globals->remote_count_remainder),
+      .wall_time = (int64_t)(now - remote_globals->remote_last_at),
+  };
+  remote_globals->remote_pending_us = 0;
+  remote_globals->remote_last_at = now;
+
+  if (datadog_php_profiling_cpu_time_enabled) {
+    datadog_php_cpu_time_result cpu_now =
+        datadog_php_cpu_time_of(remote_globals->php_thread);
+    if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+      struct timespec now = cpu_now.ok;
+      struct timespec then = remote_globals->remote_last_cpu;
+      int64_t current = now.tv_sec * INT64_C(1000000000) + now.tv_nsec;
+      int64_t prev = then.tv_sec * INT64_C(1000000000) + then.tv_nsec;
+      values.cpu_time = current - prev;
+      remote_globals->remote_last_cpu = now;
+    }
+  }
+
+  weight_times(&values);
+  ddtrace_profiling_context context = {0, 0};
+  datadog_php_record_labels labels = {0};
+  datadog_php_recorder_plugin_record(values, remote_globals->php_thread_id,
+                                     sample, context, &labels);
+}
+
+/* Ticks one PHP thread if it's due. This runs on the collector thread with
+ * the registry mutex held. Returns the thread's current interval. When remote
+ * sampling, the tick is left to the caller, which is told through `walk`
+ * whether it's due.
+ */
+static uint32_t
+stack_collector_tick(stack_collector_thread_globals *remote_globals,
+                     uv_hrtime_t now, bool *walk) {
+  uint32_t interval_ms = BASE_INTERVAL_MS;
+  if (slow_request_threshold_ns &&
+      now - remote_globals->request_started_at >= slow_request_threshold_ns) {
+    interval_ms = SLOW_REQUEST_INTERVAL_MS;
+  } else if (atomic_load(&remote_globals->trace_kept)) {
+    interval_ms = KEPT_TRACE_INTERVAL_MS;
+  }
+  if (now < datadog_php_profiling_burst_until) {
+    uint32_t burst_interval_ms = datadog_php_profiling_burst_interval_ms;
+    if (burst_interval_ms < interval_ms) {
+      interval_ms = burst_interval_ms;
+    }
+  }
+  uint32_t region_interval_ms =
+      atomic_load(&remote_globals->region_interval_ms);
+  if (region_interval_ms && region_interval_ms < interval_ms) {
+    interval_ms = region_interval_ms;
+  }
+
+  // Timers aren't exact, so allow a tick to come up to half an interval early.
+  uv_hrtime_t interval_ns = interval_ms * UINT64_C(1000000);
+  if (now + interval_ns / 2 < remote_globals->next_tick_at) {
+    return interval_ms;
+  }
+  remote_globals->next_tick_at += interval_ns;
+  if (remote_globals->next_tick_at < now) {
+    remote_globals->next_tick_at = now + interval_ns;
+  }
+
+  if (remote_sampling) {
+    *walk = true;
+    return interval_ms;
+  }
 
   /* There is a race condition here; the VM could handle the interrupt after
    * the counter has been incremented but before the global vm_interrupt has
@@ -149,18 +729,57 @@ static void datadog_php_stack_collector_collect_cb(uv_timer_t *handle) {
    * count, or sometimes it will run and be 0. Both situations should be
    * tolerable.
    */
+  atomic_fetch_add(&remote_globals->pending_us, interval_ms * UINT64_C(1000));
   uint32_t prev_val = atomic_fetch_add(&remote_globals->interrupt_count, 1);
+  if (split_samples && prev_val < TICK_TIMES_CAPACITY) {
+    atomic_store_explicit(&remote_globals->tick_times[prev_val], uv_hrtime(),
+                          memory_order_relaxed);
+  }
   if (prev_val == 0) {
     remote_globals->eg->vm_interrupt = 1;
   }
+  return interval_ms;
+}
+
+static void datadog_php_stack_collector_collect_cb(uv_timer_t *handle) {
+  uv_hrtime_t now = uv_hrtime();
+  uint32_t min_interval_ms = BASE_INTERVAL_MS;
+
+  uv_mutex_lock(&globals.registry_mutex);
+  for (stack_collector_thread_globals *thread = globals.registry; thread;
+       thread = thread->next) {
+    bool walk = false;
+    uint32_t interval_ms = stack_collector_tick(thread, now, &walk);
+    if (interval_ms < min_interval_ms) {
+      min_interval_ms = interval_ms;
+    }
+
+    /* The thread can't remove itself while it's marked, so it's still in the
+     * registry afterwards and its next thread is current. Threads which were
+     * added meanwhile are at the head, and are ticked next time.
+     */
+    if (walk) {
+      globals.walking = thread;
+      uv_mutex_unlock(&globals.registry_mutex);
+      stack_collector_remote_sample(thread, interval_ms);
+      uv_mutex_lock(&globals.registry_mutex);
+      globals.walking = NULL;
+      uv_cond_broadcast(&globals.registry_cond);
+    }
+  }
+  uv_mutex_unlock(&globals.registry_mutex);
+
+  // Only wake up more often while some thread needs it.
+  uint64_t repeat = min_interval_ms;
+  if (uv_timer_get_repeat(handle) != repeat) {
+    uv_timer_set_repeat(handle, repeat);
+  }
 }
 
 void stop_uv_async_cb(uv_async_t *handle) {
-  stack_collector_thread_globals *remote_globals = handle->data;
   uv_stop(handle->loop);
-  uv_close((uv_handle_t *)&remote_globals->uv_timer, NULL);
-  uv_close((uv_handle_t *)&remote_globals->stop_async, NULL);
-  remote_globals->have_uv_loop = false;
+  uv_close((uv_handle_t *)&globals.uv_timer, NULL);
+  uv_close((uv_handle_t *)&globals.stop_async, NULL);
 }
 
 static void libuv_close_handles(uv_handle_t *handle, void *arg) {
@@ -168,12 +787,12 @@ static void libuv_close_handles(uv_handle_t *handle, void *arg) {
   uv_close(handle, NULL);
 }
 
-static void *datadog_php_stack_collector_loop(
-    stack_collector_thread_globals *remote_globals) {
+static void *datadog_php_stack_collector_loop(void *arg) {
+  (void)arg;
   prof_logger.log_cstr(DATADOG_PHP_LOG_DEBUG,
                        "[Datadog Profiling] Stack Collector online.");
 
-  uv_loop_t *loop = &remote_globals->uv_loop;
+  uv_loop_t *loop = &globals.uv_loop;
 
   // If there are unclosed handles this will return non-zero
   if (uv_run(loop, UV_RUN_DEFAULT)) {
@@ -198,8 +817,8 @@ static void *datadog_php_stack_collector_loop(
   return NULL;
 }
 
-static bool libuv_activate(stack_collector_thread_globals *remote_globals) {
-  uv_loop_t *loop = &remote_globals->uv_loop;
+static bool libuv_startup(void) {
+  uv_loop_t *loop = &globals.uv_loop;
   if (uv_loop_init(loop) != 0) {
     const char *msg =
         "[Datadog Profiling] Stack Collector uv_loop_init returned non-zero status";
@@ -207,7 +826,7 @@ static bool libuv_activate(stack_collector_thread_globals *remote_globals) {
     return false;
   }
 
-  uv_timer_t *timer = &remote_globals->uv_timer;
+  uv_timer_t *timer = &globals.uv_timer;
   if (uv_timer_init(loop, timer)) {
     const char *msg =
         "[Datadog Profiling] Stack Collector uv_timer_init returned non-zero status.";
@@ -215,19 +834,16 @@ static bool libuv_activate(stack_collector_thread_globals *remote_globals) {
     goto cleanup_loop;
   }
 
-  timer->data = remote_globals;
-
   // timeout and repeat are in milliseconds.
   uv_timer_cb cb = datadog_php_stack_collector_collect_cb;
-  if (uv_timer_start(timer, cb, 10, 10) != 0) {
+  if (uv_timer_start(timer, cb, BASE_INTERVAL_MS, BASE_INTERVAL_MS) != 0) {
     const char *msg =
         "[Datadog Profiling] Stack Collector uv_timer_start returned non-zero status.";
     prof_logger.log_cstr(DATADOG_PHP_LOG_ERROR, msg);
     goto cleanup_timer;
   }
 
-  uv_async_t *stop_async = &remote_globals->stop_async;
-  stop_async->data = remote_globals;
+  uv_async_t *stop_async = &globals.stop_async;
   if (uv_async_init(loop, stop_async, stop_uv_async_cb) != 0) {
     const char *msg =
         "[Datadog Profiling] Stack Collector uv_async_init  returned non-zero status.";
@@ -245,29 +861,9 @@ cleanup_loop:
   return false;
 }
 
-void datadog_php_stack_collector_activate(void) {
-  if (!enabled)
-    return;
-
-  atomic_store(&thread_globals.interrupt_count, 0);
-  thread_globals.eg = &executor_globals;
-  thread_globals.have_uv_loop = false;
-  thread_globals.last_event_at = uv_hrtime();
-
-  struct timespec cpu_spec = {};
-  if (datadog_php_profiling_cpu_time_enabled) {
-    datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
-    if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
-      cpu_spec = cpu_now.ok;
-    }
-  }
-  thread_globals.last_cpu = cpu_spec;
-
-  datadog_php_stack_sample_ctor(&thread_globals.sample);
-
-  thread_globals.have_uv_loop = libuv_activate(&thread_globals);
-  if (!thread_globals.have_uv_loop) {
-    return;
+static bool stack_collector_thread_start(void) {
+  if (!libuv_startup()) {
+    return false;
   }
 
   enum {
@@ -276,8 +872,7 @@ void datadog_php_stack_collector_activate(void) {
     PTHREAD_CREATE_EINVAL = EINVAL,
     PTHREAD_CREATE_EPERM = EPERM,
   } status = pthread_create(&globals.thread, NULL,
-                            (void *(*)(void *))datadog_php_stack_collector_loop,
-                            &thread_globals);
+                            datadog_php_stack_collector_loop, NULL);
 
   if (status != PTHREAD_CREATE_SUCCESS) {
     const char *str = NULL;
@@ -298,20 +893,741 @@ void datadog_php_stack_collector_activate(void) {
       str = "[Datadog Profiling] Error creating pthread; unknown error.";
     }
     prof_logger.log_cstr(DATADOG_PHP_LOG_ERROR, str);
-    return;
+
+    // the loop never ran, so its handles need closing here
+    uv_walk(&globals.uv_loop, libuv_close_handles, NULL);
+    (void)uv_run(&globals.uv_loop, UV_RUN_NOWAIT);
+    (void)uv_loop_close(&globals.uv_loop);
+    return false;
   }
 
   globals.have_thread = true;
+  return true;
 }
 
-static void datadog_php_stack_collector_interrupt_function(
-    zend_execute_data *execute_data) {
+static int64_t timespec_ns(struct timespec ts) {
+  return ts.tv_sec * INT64_C(1000000000) + ts.tv_nsec;
+}
+
+/* Records a sample with only the synthetic frame `name`, for the wall and cpu
+ * time since `wall_since` and `cpu_since`, which are then moved up to now.
+ * It has no trace context, as the tracer may not be active at these times.
+ */
+static void stack_collector_record_phase(datadog_php_string_view name,
+                                         uv_hrtime_t *wall_since,
+                                         struct timespec *cpu_since) {
+  uv_hrtime_t now = uv_hrtime();
+  datadog_php_record_values values = {
+      .wall_time = (int64_t)(now - *wall_since),
+  };
+  *wall_since = now;
+
+  if (datadog_php_profiling_cpu_time_enabled) {
+    datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+    if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+      values.cpu_time = timespec_ns(cpu_now.ok) - timespec_ns(*cpu_since);
+      *cpu_since = cpu_now.ok;
+    }
+  }
+
+  datadog_php_stack_sample_frame frame = {
+      .function = name,
+      .file = DATADOG_PHP_STRING_VIEW_INIT,
+      .lineno = 0,
+  };
+  datadog_php_stack_sample_ctor(&thread_globals.sample);
+  if (!datadog_php_stack_sample_try_add(&thread_globals.sample, frame)) {
+    return;
+  }
+
+  weight_times(&values);
+  ddtrace_profiling_context context = {0, 0};
+  datadog_php_record_labels labels = {0};
+  datadog_php_recorder_plugin_record(values, zend_thread_id,
+                                     &thread_globals.sample, context, &labels);
+}
+
+// Marks the end of a request, which is when the thread's idle time begins.
+static void stack_collector_idle_begin(void) {
+  thread_globals.idle_since = uv_hrtime();
+  thread_globals.idle_since_cpu = (struct timespec){0, 0};
+  if (datadog_php_profiling_cpu_time_enabled) {
+    datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+    if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+      thread_globals.idle_since_cpu = cpu_now.ok;
+    }
+  }
+}
+
+// Attributes the cpu time since the last call to `span_id`.
+static void span_cpu_account(uint64_t span_id, struct timespec now) {
+  int64_t cpu_time =
+      timespec_ns(now) - timespec_ns(thread_globals.span_cpu_last);
+  thread_globals.span_cpu_last = now;
+  if (!span_id || cpu_time <= 0) {
+    return;
+  }
+
+  uint32_t free_index = SPAN_CPU_CAPACITY;
+  for (uint32_t i = 0; i != SPAN_CPU_CAPACITY; ++i) {
+    if (thread_globals.span_cpu[i].span_id == span_id) {
+      thread_globals.span_cpu[i].cpu_time += cpu_time;
+      return;
+    }
+    if (!thread_globals.span_cpu[i].span_id &&
+        free_index == SPAN_CPU_CAPACITY) {
+      free_index = i;
+    }
+  }
+
+  if (free_index == SPAN_CPU_CAPACITY) {
+    free_index = thread_globals.span_cpu_next++ % SPAN_CPU_CAPACITY;
+  }
+  thread_globals.span_cpu[free_index].span_id = span_id;
+  thread_globals.span_cpu[free_index].cpu_time = cpu_time;
+}
+
+int64_t datadog_php_stack_collector_take_span_cpu_time(uint64_t span_id) {
+  if (!enabled || !datadog_php_profiling_cpu_time_enabled || !span_id) {
+    return 0;
+  }
+
+  // Account for the time since the last sample before reading the total.
+  datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+  if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+    ddtrace_profiling_context context =
+        datadog_profiling_get_profiling_context();
+    span_cpu_account(context.span_id, cpu_now.ok);
+  }
+
+  for (uint32_t i = 0; i != SPAN_CPU_CAPACITY; ++i) {
+    if (thread_globals.span_cpu[i].span_id == span_id) {
+      thread_globals.span_cpu[i].span_id = 0;
+      return thread_globals.span_cpu[i].cpu_time;
+    }
+  }
+  return 0;
+}
+
+/* Returns why the internal function `func` blocks, or an empty string. The
+ * name is only formatted and looked up the first time `func` is seen, which is
+ * safe because internal functions live at least until the request ends.
+ */
+static datadog_php_string_view wait_reason_of(const zend_function *func) {
+  size_t slot = ((uintptr_t)func / sizeof(void *)) % WAIT_REASON_CACHE_CAPACITY;
+  if (thread_globals.wait_reason_cache[slot].func == func) {
+    return thread_globals.wait_reason_cache[slot].reason;
+  }
+
+  datadog_php_string_view reason = DATADOG_PHP_STRING_VIEW_INIT;
+  zend_string *function_name = func->common.function_name;
+  if (function_name) {
+    zend_class_entry *scope = func->common.scope;
+    char buffer[256];
+    int len = snprintf(buffer, sizeof buffer, "%.*s%s%.*s",
+                       scope ? (int)ZSTR_LEN(scope->name) : 0,
+                       scope ? ZSTR_VAL(scope->name) : "", scope ? "::" : "",
+                       (int)ZSTR_LEN(function_name), ZSTR_VAL(function_name));
+    if (len > 0 && (size_t)len < sizeof buffer) {
+      datadog_php_string_view name = {(size_t)len, buffer};
+      reason = datadog_php_wait_reasons_find(&wait_reasons, name);
+    }
+  }
+
+  thread_globals.wait_reason_cache[slot].func = func;
+  thread_globals.wait_reason_cache[slot].reason = reason;
+  return reason;
+}
+
+#if NATIVE_FRAMES_SUPPORTED
+/* A real-time signal, as SIGPROF is what PHP's max_execution_time uses. */
+#define NATIVE_FRAMES_SIGNAL (SIGRTMIN + 4)
+
+/* Walks the native stack of the interrupted code by its frame pointers, from
+ * the leaf up to the native boundary. The frames above the boundary are on the
+ * stack between the interrupted stack pointer and the boundary, so all of the
+ * memory which is read is mapped, even if some code omits frame pointers and
+ * the walk follows garbage. This runs in a signal handler, so it only reads
+ * memory and writes this thread's native stacks.
+ */
+static void stack_collector_native_capture(const ucontext_t *context) {
+  uintptr_t boundary = thread_globals.native_boundary;
+  if (thread_globals.native_reading || !boundary || !thread_globals.eg) {
+    return;
+  }
+  zend_execute_data *execute_data = thread_globals.eg->current_execute_data;
+  if (!execute_data || !execute_data->func ||
+      execute_data->func->type != ZEND_INTERNAL_FUNCTION) {
+    return;
+  }
+
+#if defined(__x86_64__)
+  uintptr_t pc = (uintptr_t)context->uc_mcontext.gregs[REG_RIP];
+  uintptr_t fp = (uintptr_t)context->uc_mcontext.gregs[REG_RBP];
+  uintptr_t sp = (uintptr_t)context->uc_mcontext.gregs[REG_RSP];
+#else
+  uintptr_t pc = (uintptr_t)context->uc_mcontext.pc;
+  uintptr_t fp = (uintptr_t)context->uc_mcontext.regs[29];
+  uintptr_t sp = (uintptr_t)context->uc_mcontext.sp;
+#endif
+  // A boundary from a bailout or from another stack doesn't apply.
+  if (sp >= boundary || boundary - sp > NATIVE_STACK_MAX_SPAN) {
+    return;
+  }
+
+  struct native_stack_s *stack =
+      &thread_globals.native_stacks[thread_globals.native_captures++ %
+                                    NATIVE_STACKS_CAPACITY];
+  stack->execute_data = execute_data;
+  stack->func = execute_data->func;
+  uint16_t depth = 0;
+  stack->addresses[depth++] = pc;
+  while (depth < NATIVE_STACK_MAX_DEPTH && fp >= sp &&
+         fp + 2 * sizeof(uintptr_t) <= boundary &&
+         fp % sizeof(uintptr_t) == 0) {
+    const uintptr_t *record = (const uintptr_t *)fp;
+    uintptr_t next = record[0];
+    uintptr_t return_address = record[1];
+    if (next <= fp || next >= boundary || !return_address) {
+      break;
+    }
+    stack->addresses[depth++] = return_address;
+    fp = next;
+  }
+  stack->depth = depth;
+}
+
+static void stack_collector_native_signal(int signo, siginfo_t *info,
+                                          void *context) {
+  (void)signo;
+  (void)info;
+  int saved_errno = errno;
+  stack_collector_native_capture((const ucontext_t *)context);
+  errno = saved_errno;
+}
+
+/* Installs the signal handler, unless something else already handles the
+ * signal. It stays installed until module shutdown.
+ */
+static bool stack_collector_native_startup(void) {
+  struct sigaction action;
+  if (sigaction(NATIVE_FRAMES_SIGNAL, NULL, &action) != 0 ||
+      (action.sa_handler != SIG_DFL && action.sa_handler != SIG_IGN)) {
+    return false;
+  }
+
+  memset(&action, 0, sizeof action);
+  action.sa_sigaction = stack_collector_native_signal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  return sigaction(NATIVE_FRAMES_SIGNAL, &action, NULL) == 0;
+}
+
+// Timers are deleted with their request, but ignore any straggling signal.
+static void stack_collector_native_shutdown(void) {
+  struct sigaction action;
+  memset(&action, 0, sizeof action);
+  action.sa_handler = SIG_IGN;
+  sigemptyset(&action.sa_mask);
+  (void)sigaction(NATIVE_FRAMES_SIGNAL, &action, NULL);
+}
+
+/* Starts the current thread's cpu timer. It's created per request, as a timer
+ * would outlive a ZTS thread which exits.
+ */
+static void stack_collector_native_timer_start(void) {
+  thread_globals.native_captures = 0;
+  struct sigevent event;
+  memset(&event, 0, sizeof event);
+  event.sigev_notify = SIGEV_THREAD_ID;
+  event.sigev_signo = NATIVE_FRAMES_SIGNAL;
+  event.sigev_notify_thread_id = (pid_t)syscall(SYS_gettid);
+  if (timer_create(CLOCK_THREAD_CPUTIME_ID, &event,
+                   &thread_globals.native_timer) != 0) {
+    return;
+  }
+
+  struct timespec interval = {0, BASE_INTERVAL_MS * 1000000L};
+  struct itimerspec spec = {.it_interval = interval, .it_value = interval};
+  if (timer_settime(thread_globals.native_timer, 0, &spec, NULL) != 0) {
+    (void)timer_delete(thread_globals.native_timer);
+    return;
+  }
+  thread_globals.have_native_timer = true;
+}
+
+static void stack_collector_native_timer_stop(void) {
+  if (thread_globals.have_native_timer) {
+    (void)timer_delete(thread_globals.native_timer);
+    thread_globals.have_native_timer = false;
+  }
+}
+
+static int native_segment_find(struct dl_phdr_info *info, size_t size,
+                               void *data) {
+  (void)size;
+  struct native_symbol_s *symbol = data;
+  for (ElfW(Half) i = 0; i != info->dlpi_phnum; ++i) {
+    const ElfW(Phdr) *phdr = &info->dlpi_phdr[i];
+    uintptr_t start = (uintptr_t)info->dlpi_addr + phdr->p_vaddr;
+    if (phdr->p_type == PT_LOAD && symbol->address >= start &&
+        symbol->address - start < phdr->p_memsz) {
+      symbol->mapping_start = start;
+      symbol->mapping_limit = start + phdr->p_memsz;
+      symbol->mapping_offset = phdr->p_offset;
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/* Finds the shared object which contains the code at `address`, the segment
+ * of it which was loaded there, and the exported symbol which precedes it, if
+ * there is one. Like wait_reason_of, the result is cached, as dladdr and
+ * dl_iterate_phdr take the loader's lock.
+ */
+static const struct native_symbol_s *native_symbol_of(uintptr_t address) {
+  size_t slot = (address ^ address >> 12) % NATIVE_SYMBOL_CACHE_CAPACITY;
+  struct native_symbol_s *symbol = &thread_globals.native_symbol_cache[slot];
+  if (symbol->address == address) {
+    return symbol;
+  }
+
+  memset(symbol, 0, sizeof *symbol);
+  symbol->address = address;
+  Dl_info info;
+  if (dladdr((void *)address, &info) && info.dli_fname &&
+      dl_iterate_phdr(native_segment_find, symbol)) {
+    symbol->object = info.dli_fname;
+    symbol->name = info.dli_sname;
+    symbol->name_address = (uintptr_t)info.dli_saddr;
+  }
+  return symbol;
+}
+
+/* Adds the native frames of `stack` to the sample, leaf first. The walk ends
+ * at an address which isn't in any shared object, as the frame pointers which
+ * led there were likely garbage, and at the internal function's handler, which
+ * the internal frame already stands for. Symbols which aren't exported are
+ * named after their object, and can be symbolized by their mapping.
+ */
+static void
+stack_collector_add_native_frames(const struct native_stack_s *stack) {
+  uintptr_t handler = (uintptr_t)stack->func->internal_function.handler;
+  for (uint16_t i = 0; i != stack->depth; ++i) {
+    // Return addresses are after the call, which may be past its function.
+    uintptr_t address = i ? stack->addresses[i] - 1 : stack->addresses[i];
+    const struct native_symbol_s *symbol = native_symbol_of(address);
+    if (!symbol->object ||
+        (symbol->name && symbol->name_address == handler)) {
+      break;
+    }
+
+    char buffer[256];
+    datadog_php_string_view function;
+    if (symbol->name) {
+      function = datadog_php_string_view_from_cstr(symbol->name);
+    } else {
+      const char *basename = strrchr(symbol->object, '/');
+      int len = snprintf(buffer, sizeof buffer, "[%s]",
+                         basename ? basename + 1 : symbol->object);
+      if (len <= 0 || (size_t)len >= sizeof buffer) {
+        break;
+      }
+      function = (datadog_php_string_view){(size_t)len, buffer};
+    }
+
+    datadog_php_stack_sample_frame frame = {
+        .function = function,
+        .file = datadog_php_string_view_from_cstr(symbol->object),
+        .native = true,
+        .address = address,
+        .mapping_start = symbol->mapping_start,
+        .mapping_limit = symbol->mapping_limit,
+        .mapping_offset = symbol->mapping_offset,
+    };
+    if (!datadog_php_stack_sample_try_add(&thread_globals.sample, frame)) {
+      break;
+    }
+  }
+}
+#else
+static bool stack_collector_native_startup(void) { return false; }
+static void stack_collector_native_shutdown(void) {}
+#endif
+
+/* Returns the name of the opcode the leaf PHP frame is on, or NULL if there is
+ * no PHP frame. Samples are taken when the VM checks for interrupts, so this
+ * is where a loop iteration or a call began, or the call into the internal
+ * function the sample landed in.
+ */
+static const char *leaf_opcode(zend_execute_data *execute_data) {
+  while (execute_data && (!execute_data->func ||
+                          !ZEND_USER_CODE(execute_data->func->type))) {
+    execute_data = execute_data->prev_execute_data;
+  }
+  if (!execute_data || !execute_data->opline) {
+    return NULL;
+  }
+  return zend_get_opcode_name(execute_data->opline->opcode);
+}
+
+void datadog_php_stack_collector_activate(void) {
+  if (enabled && datadog_php_profiling_cpu_time_enabled) {
+    datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+    struct timespec zero = {0, 0};
+    thread_globals.span_cpu_last =
+        cpu_now.tag == DATADOG_PHP_CPU_TIME_OK ? cpu_now.ok : zero;
+    memset(thread_globals.span_cpu, 0, sizeof thread_globals.span_cpu);
+    thread_globals.span_cpu_next = 0;
+  }
+
+  /* Functions from extensions which were loaded with dl() are freed at the
+   * end of the request, and another function could reuse the address.
+   */
+  memset(thread_globals.wait_reason_cache, 0,
+         sizeof thread_globals.wait_reason_cache);
+#if NATIVE_FRAMES_SUPPORTED
+  memset(thread_globals.native_symbol_cache, 0,
+         sizeof thread_globals.native_symbol_cache);
+#endif
+
+  /* Requests which aren't sampled are never registered, so the collector
+   * thread doesn't tick them and they never take a sample.
+   */
+  request_sampled =
+      enabled && worker_sampled &&
+      (request_sample_rate == SAMPLE_RATE_ONE ||
+       sample_rate_roll() < request_sample_rate);
+  if (!request_sampled)
+    return;
+
+  zend_thread_id = (int64_t)uv_thread_self();
+
+  if (request_phases && !regions_only && thread_globals.idle_since) {
+    stack_collector_record_phase(idle_frame, &thread_globals.idle_since,
+                                 &thread_globals.idle_since_cpu);
+    thread_globals.idle_since = 0;
+  }
+
+  atomic_store(&thread_globals.interrupt_count, 0);
+  atomic_store(&thread_globals.pending_us, 0);
+#if defined(ZTS)
+  thread_globals.eg = TSRMG_BULK(executor_globals_id, zend_executor_globals *);
+#else
+  thread_globals.eg = &executor_globals;
+#endif
+  thread_globals.last_event_at = uv_hrtime();
+
+  /* Interrupt the VM as soon as it starts running, which marks the end of
+   * request startup. This doesn't count as a tick. If the engine clears the
+   * interrupt before then, startup ends with the first tick instead.
+   */
+  thread_globals.in_startup =
+      request_phases && !remote_sampling && !regions_only;
+  if (thread_globals.in_startup) {
+    thread_globals.eg->vm_interrupt = 1;
+  }
+
+  thread_globals.request_started_at = thread_globals.last_event_at;
+  thread_globals.next_tick_at =
+      thread_globals.last_event_at + BASE_INTERVAL_MS * UINT64_C(1000000);
+  thread_globals.count_remainder = 0;
+  atomic_store(&thread_globals.trace_kept, false);
+  thread_globals.memory_peak = memory_enabled ? zend_memory_peak_usage(0) : 0;
+
+  struct timespec cpu_spec = {};
+  if (datadog_php_profiling_cpu_time_enabled) {
+    datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+    if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+      cpu_spec = cpu_now.ok;
+    }
+  }
+  thread_globals.last_cpu = cpu_spec;
+
+  thread_globals.php_thread = pthread_self();
+  thread_globals.php_thread_id = zend_thread_id;
+  thread_globals.remote_pending_us = 0;
+  thread_globals.remote_count_remainder = 0;
+  thread_globals.remote_last_at = thread_globals.last_event_at;
+  thread_globals.remote_last_cpu = cpu_spec;
+
+  datadog_php_stack_sample_ctor(&thread_globals.sample);
+
+  thread_globals.region_depth = 0;
+  atomic_store(&thread_globals.region_interval_ms, 0);
+  thread_globals.registered = false;
+  if (!regions_only) {
+    stack_collector_register();
+  }
+}
+
+bool datadog_php_stack_collector_start_region(uint32_t interval_ms) {
+  if (!request_sampled) {
+    return false;
+  }
+  if (thread_globals.region_depth++) {
+    return true;
+  }
+
+  atomic_store(&thread_globals.region_interval_ms, interval_ms);
+  if (regions_only) {
+    // Nothing before the region counts towards its first sample.
+    uv_hrtime_t now = uv_hrtime();
+    thread_globals.last_event_at = now;
+    thread_globals.next_tick_at = now + BASE_INTERVAL_MS * UINT64_C(1000000);
+    thread_globals.remote_last_at = now;
+    if (datadog_php_profiling_cpu_time_enabled) {
+      datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+      if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+        thread_globals.last_cpu = cpu_now.ok;
+        thread_globals.remote_last_cpu = cpu_now.ok;
+      }
+    }
+    stack_collector_register();
+  }
+  return true;
+}
+
+bool datadog_php_stack_collector_end_region(void) {
+  if (!request_sampled || !thread_globals.region_depth) {
+    return false;
+  }
+  if (--thread_globals.region_depth) {
+    return true;
+  }
+
+  atomic_store(&thread_globals.region_interval_ms, 0);
+  if (regions_only) {
+    stack_collector_unregister();
+  }
+  return true;
+}
+
+uint64_t datadog_php_stack_collector_exclude_time(int64_t wall_time,
+                                                  int64_t cpu_time) {
+  if (!enabled)
+    return 0;
+
+  thread_globals.last_event_at += (uv_hrtime_t)wall_time;
+
+  if (datadog_php_profiling_cpu_time_enabled) {
+    struct timespec *last_cpu = &thread_globals.last_cpu;
+    int64_t nsec = last_cpu->tv_nsec + cpu_time;
+    last_cpu->tv_sec += nsec / INT64_C(1000000000);
+    last_cpu->tv_nsec = nsec % INT64_C(1000000000);
+  }
+
+  /* Ticks kept coming while the time was spent, and the next sample would
+   * count them too. So take up to the excluded time from the pending ticks'
+   * intervals, and hand its weight to the caller's sample instead.
+   */
+  uint64_t excluded_us = wall_time > 0 ? (uint64_t)wall_time / 1000u : 0;
+  uint64_t pending_us = atomic_load(&thread_globals.pending_us);
+  uint64_t taken_us;
+  do {
+    taken_us = pending_us < excluded_us ? pending_us : excluded_us;
+  } while (taken_us &&
+           !atomic_compare_exchange_weak(&thread_globals.pending_us,
+                                         &pending_us, pending_us - taken_us));
+  if (!taken_us) {
+    return 0;
+  }
+  return weighted_count(taken_us, &thread_globals.count_remainder);
+}
+
+/* Records the stack in thread_globals.sample as one sample per tick, with
+ * the `values` spread across them by wall time. Each sample ends when its tick
+ * fired, except for the last one which ends at `end` and absorbs any ticks
+ * beyond TICK_TIMES_CAPACITY. The stack cannot change while the thread is in
+ * an internal call, so this is what a signal-based sampler would have seen,
+ * but without interrupting the call.
+ */
+static void stack_collector_record_split(datadog_php_record_values values,
+                                         pending_ticks ticks,
+                                         uv_hrtime_t begin, uv_hrtime_t end,
+                                         ddtrace_profiling_context context,
+                                         datadog_php_record_labels labels) {
+  uint32_t count = ticks.count;
+  uint32_t n = count < TICK_TIMES_CAPACITY ? count : TICK_TIMES_CAPACITY;
+  uv_hrtime_t prev = begin;
+  uint64_t interval_us_taken = 0;
+  int64_t cpu_remaining = values.cpu_time;
+
+  for (uint32_t i = 0; i != n; ++i) {
+    uv_hrtime_t tick_time = end;
+    if (i + 1 != n) {
+      tick_time = atomic_load_explicit(&thread_globals.tick_times[i],
+                                       memory_order_relaxed);
+      // Stale or unwritten slot; pretend the ticks were evenly spaced.
+      if (tick_time < prev || tick_time > end) {
+        tick_time = begin + (end - begin) * (i + 1) / count;
+      }
+    }
+
+    int64_t wall_time = (int64_t)(tick_time - prev);
+    int64_t cpu_time = cpu_remaining;
+    if (i + 1 != n && values.wall_time > 0) {
+      cpu_time = values.cpu_time * wall_time / values.wall_time;
+    }
+    cpu_remaining -= cpu_time;
+
+    // The ticks' intervals are spread evenly, with the rest on the last one.
+    uint64_t interval_us = ticks.interval_us - interval_us_taken;
+    if (i + 1 != n) {
+      interval_us = ticks.interval_us * (i + 1) / count - interval_us_taken;
+    }
+    interval_us_taken += interval_us;
+
+    datadog_php_record_values tick_values = {
+        .count = weighted_count(interval_us, &thread_globals.count_remainder),
+        .wall_time = wall_time,
+        .cpu_time = cpu_time,
+        // the peak is only known as of the end, so it goes to the last tick
+        .memory_peak_growth = i + 1 != n ? 0 : values.memory_peak_growth,
+    };
+    tick_values.memory_usage = values.memory_usage * (int64_t)tick_values.count;
+    weight_times(&tick_values);
+    labels.end_timestamp = tick_time;
+    datadog_php_recorder_plugin_record(tick_values, zend_thread_id,
+                                       &thread_globals.sample, context,
+                                       &labels);
+    prev = tick_time;
+  }
+}
+
+/* Adds the PHP frames from `execute_data` to the frames in the sample, and
+ * [request shutdown] as the root frame while the request is shutting down.
+ */
+static void stack_collector_collect_php(zend_execute_data *execute_data,
+                                        zend_execute_data *bottom) {
+  datadog_php_stack_collect_onto_until(execute_data, bottom,
+                                       &thread_globals.sample);
+  if (!thread_globals.sample.depth) {
+    return;
+  }
+
+#ifdef EG_FLAGS_IN_SHUTDOWN
+  if (request_phases && (EG(flags) & EG_FLAGS_IN_SHUTDOWN)) {
+    datadog_php_stack_sample_frame root = {
+        .function = request_shutdown_frame,
+        .file = DATADOG_PHP_STRING_VIEW_INIT,
+        .lineno = 0,
+    };
+    (void)datadog_php_stack_sample_try_add(&thread_globals.sample, root);
+  }
+#endif
+}
+
+// Forgets the native stacks which were captured since the last sample.
+static void stack_collector_native_drop(void) {
+#if NATIVE_FRAMES_SUPPORTED
+  thread_globals.native_captures = 0;
+#endif
+}
+
+/* If native stacks were captured during the internal call on top, this records
+ * the sample once per stack, with the stack's native frames above the PHP
+ * frames and the values spread evenly across them, and returns true. This way
+ * the cpu time of a long internal call is split by where it was spent in native
+ * code. Otherwise it returns false, and the sample is recorded as usual.
+ */
+static bool stack_collector_record_native(datadog_php_record_values values,
+                                          pending_ticks ticks,
+                                          zend_execute_data *execute_data,
+                                          zend_execute_data *bottom,
+                                          ddtrace_profiling_context context,
+                                          datadog_php_record_labels labels) {
+#if NATIVE_FRAMES_SUPPORTED
+  thread_globals.native_reading = 1;
+  atomic_signal_fence(memory_order_seq_cst);
+
+  uint32_t captures = thread_globals.native_captures;
+  uint32_t n = captures < NATIVE_STACKS_CAPACITY ? captures
+                                                 : NATIVE_STACKS_CAPACITY;
+  const struct native_stack_s *stacks[NATIVE_STACKS_CAPACITY];
+  uint32_t matches = 0;
+  for (uint32_t i = 0; i != n; ++i) {
+    const struct native_stack_s *stack = &thread_globals.native_stacks[i];
+    if (execute_data && stack->execute_data == execute_data &&
+        stack->func == execute_data->func) {
+      stacks[matches++] = stack;
+    }
+  }
+
+  if (matches) {
+    values.count = weighted_count(ticks.interval_us,
+                                  &thread_globals.count_remainder);
+    values.memory_usage *= (int64_t)values.count;
+    weight_times(&values);
+
+    // Each stack gets its share of the values, with the rest on the last one.
+    datadog_php_record_values taken = {0};
+    for (uint32_t i = 0; i != matches; ++i) {
+      datadog_php_record_values share = values;
+      if (i + 1 != matches) {
+        share.count = values.count * (i + 1) / matches - taken.count;
+        share.wall_time =
+            values.wall_time * (i + 1) / matches - taken.wall_time;
+        share.cpu_time = values.cpu_time * (i + 1) / matches - taken.cpu_time;
+        share.memory_usage =
+            values.memory_usage * (i + 1) / matches - taken.memory_usage;
+        share.memory_peak_growth = 0;
+      } else {
+        share.count -= taken.count;
+        share.wall_time -= taken.wall_time;
+        share.cpu_time -= taken.cpu_time;
+        share.memory_usage -= taken.memory_usage;
+      }
+      taken.count += share.count;
+      taken.wall_time += share.wall_time;
+      taken.cpu_time += share.cpu_time;
+      taken.memory_usage += share.memory_usage;
+
+      datadog_php_stack_sample_ctor(&thread_globals.sample);
+      stack_collector_add_native_frames(stacks[i]);
+      stack_collector_collect_php(execute_data, bottom);
+      datadog_php_recorder_plugin_record(share, zend_thread_id,
+                                         &thread_globals.sample, context,
+                                         &labels);
+    }
+  }
+
+  thread_globals.native_captures = 0;
+  atomic_signal_fence(memory_order_seq_cst);
+  thread_globals.native_reading = 0;
+  return matches != 0;
+#else
+  (void)values;
+  (void)ticks;
+  (void)execute_data;
+  (void)bottom;
+  (void)context;
+  (void)labels;
+  return false;
+#endif
+}
+
+/* Samples the stack of the current thread, crediting it with the ticks and
+ * time which accumulated since the previous sample. The walk stops after the
+ * `bottom` frame if it's not NULL. The `fiber_id` is the object handle of the
+ * running fiber, or 0 if there isn't one.
+ */
+static void stack_collector_sample(zend_execute_data *execute_data,
+                                   zend_execute_data *bottom,
+                                   uint32_t fiber_id) {
   if (!enabled || !datadog_php_profiling_recorder_enabled) {
     return;
   }
 
-  uint32_t interrupt_count =
-      atomic_exchange(&thread_globals.interrupt_count, 0);
+  if (UNEXPECTED(thread_globals.in_startup)) {
+    thread_globals.in_startup = false;
+    stack_collector_record_phase(request_startup_frame,
+                                 &thread_globals.last_event_at,
+                                 &thread_globals.last_cpu);
+  }
+
+  pending_ticks ticks = stack_collector_take_ticks();
 
   /* This may be 0 due to legitimate cases. Our zend_execute_internal override
    * may call this function and then the engine may call it again when it does
@@ -319,7 +1635,7 @@ static void datadog_php_stack_collector_interrupt_function(
    * It may also be 0 if another extension triggered the interrupt.
    * Therefore, don't consider interrupt_count == 0 to be a defect.
    */
-  if (interrupt_count == 0) {
+  if (ticks.count == 0) {
     return;
   }
 
@@ -327,8 +1643,9 @@ static void datadog_php_stack_collector_interrupt_function(
   thread_globals.last_event_at = uv_hrtime();
 
   int64_t cpu_time = 0;
+  datadog_php_cpu_time_result cpu_now = {.tag = DATADOG_PHP_CPU_TIME_ERR};
   if (datadog_php_profiling_cpu_time_enabled) {
-    datadog_php_cpu_time_result cpu_now = datadog_php_cpu_time_now();
+    cpu_now = datadog_php_cpu_time_now();
     if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
       struct timespec now = cpu_now.ok;
       struct timespec then = thread_globals.last_cpu;
@@ -339,25 +1656,137 @@ static void datadog_php_stack_collector_interrupt_function(
     }
   }
 
-  datadog_php_stack_collect(execute_data, &thread_globals.sample);
+  datadog_php_stack_sample_ctor(&thread_globals.sample);
+  stack_collector_collect_php(execute_data, bottom);
   if (!thread_globals.sample.depth) {
+    stack_collector_native_drop();
     return;
   }
 
   uv_hrtime_t ns_since_last = thread_globals.last_event_at - last_event_at;
   datadog_php_record_values values = {
-      .count = (int64_t)interrupt_count,
+      .count = 0,
       .wall_time = (int64_t)ns_since_last,
       .cpu_time = cpu_time,
   };
 
+  /* We're at a safepoint on the PHP thread, so reading the memory manager is
+   * cheap. Until it's weighted, memory_usage holds the bytes in use.
+   */
+  if (memory_enabled) {
+    size_t peak = zend_memory_peak_usage(0);
+    values.memory_usage = (int64_t)zend_memory_usage(0);
+    // memory_reset_peak_usage() may have lowered the peak since last time
+    if (peak > thread_globals.memory_peak) {
+      values.memory_peak_growth = (int64_t)(peak - thread_globals.memory_peak);
+    }
+    thread_globals.memory_peak = peak;
+  }
+
   struct ddtrace_profiling_context context =
       datadog_profiling_get_profiling_context();
 
+  if (cpu_now.tag == DATADOG_PHP_CPU_TIME_OK) {
+    span_cpu_account(context.span_id, cpu_now.ok);
+  }
+
+  /* The tracer may only make its sampling decision partway through the
+   * request, so check it on every sample. The collector thread picks it up
+   * from the next tick on.
+   */
+  if (kept_trace_boost && context.local_root_span_id) {
+    atomic_store(&thread_globals.trace_kept,
+                 datadog_profiling_get_sampling_priority() >= 1);
+  }
+
+  datadog_php_record_labels labels = {.fiber_id = fiber_id};
+  datadog_php_record_labels_set_trace_endpoint(&labels);
+  if (wait_reason_enabled && execute_data && execute_data->func &&
+      execute_data->func->type == ZEND_INTERNAL_FUNCTION) {
+    datadog_php_string_view reason = wait_reason_of(execute_data->func);
+    labels.wait_reason = reason.ptr;
+    labels.wait_reason_len =
+        (uint8_t)(reason.len < UINT8_MAX ? reason.len : UINT8_MAX);
+  }
+  if (line_hotspots) {
+    const char *opcode = leaf_opcode(execute_data);
+    if (opcode) {
+      size_t len = strlen(opcode);
+      labels.opcode = opcode;
+      labels.opcode_len = (uint8_t)(len < UINT8_MAX ? len : UINT8_MAX);
+    }
+  }
+  if (native_frames &&
+      stack_collector_record_native(values, ticks, execute_data, bottom,
+                                    context, labels)) {
+    return;
+  }
+  if (split_samples && ticks.count > 1) {
+    stack_collector_record_split(values, ticks, last_event_at,
+                                 thread_globals.last_event_at, context, labels);
+    return;
+  }
+
+  values.count = (int64_t)weighted_count(ticks.interval_us,
+                                         &thread_globals.count_remainder);
+  values.memory_usage *= (int64_t)values.count;
+  weight_times(&values);
+
   datadog_php_recorder_plugin_record(values, zend_thread_id,
-                                     &thread_globals.sample, context);
+                                     &thread_globals.sample, context, &labels);
 }
 
+static void datadog_php_stack_collector_interrupt_function(
+    zend_execute_data *execute_data) {
+  zend_execute_data *bottom = NULL;
+  uint32_t fiber_id = 0;
+
+#if PHP_VERSION_ID >= 80100
+  zend_fiber *fiber = EG(active_fiber);
+  if (fiber) {
+    fiber_id = fiber->std.handle;
+    bottom = stitch_fibers ? NULL : fiber->stack_bottom;
+  }
+#endif
+
+  stack_collector_sample(execute_data, bottom, fiber_id);
+}
+
+#if PHP_VERSION_ID >= 80100
+/* A pending tick was earned by the fiber which is switching out, so sample it
+ * now while its frames are still current. Otherwise the tick gets credited to
+ * wherever the interrupt lands after the switch, which for async frameworks is
+ * usually the scheduler. The engine hasn't switched stacks yet when it calls
+ * this, but EG(active_fiber) may already refer to `to`, so use `from`.
+ */
+static void datadog_php_stack_collector_fiber_switch(zend_fiber_context *from,
+                                                     zend_fiber_context *to) {
+  (void)to;
+#if NATIVE_FRAMES_SUPPORTED
+  /* The native boundary is on the stack which is switching out. Calls on the
+   * other stack which were interrupted by a switch restore their own when they
+   * return.
+   */
+  if (native_frames) {
+    thread_globals.native_boundary = 0;
+  }
+#endif
+  if (!atomic_load(&thread_globals.interrupt_count)) {
+    return;
+  }
+
+  zend_execute_data *bottom = NULL;
+  uint32_t fiber_id = 0;
+  if (from->kind == zend_ce_fiber) {
+    zend_fiber *fiber = zend_fiber_from_context(from);
+    fiber_id = fiber->std.handle;
+    bottom = stitch_fibers ? NULL : fiber->stack_bottom;
+  }
+
+  stack_collector_sample(EG(current_execute_data), bottom, fiber_id);
+}
+#endif
+
 ZEND_API void
 datadog_profiling_interrupt_function(zend_execute_data *execute_data) {
   datadog_php_stack_collector_interrupt_function(execute_data);
@@ -369,6 +1798,27 @@ static void datadog_php_stack_collector_interrupt_function_helper(
   globals.prev_interrupt_function(execute_data);
 }
 
+/* While zend_execute_internal is set, the compiler emits ZEND_DO_FCALL instead
+ * of ZEND_DO_ICALL, and every internal call pays for the hook, sampled or not.
+ * It's only installed when this process takes samples on the PHP thread:
+ * profiling is enabled, the worker is sampled and can have sampled requests,
+ * and the collector thread isn't walking the stacks itself.
+ * This runs once, during the first activate, before any thread has compiled
+ * or run a request, and it's never changed afterwards. The VM reads the global
+ * without synchronization, so changing it while requests run would race.
+ * Code compiled before then, such as preloaded scripts, and code which another
+ * process put into opcache's shared memory may use ZEND_DO_ICALL regardless;
+ * samples of those calls go to their caller.
+ */
+static void stack_collector_install_execute_internal(void) {
+  if (remote_sampling || !worker_sampled || !request_sample_rate) {
+    return;
+  }
+  globals.prev_execute_internal =
+      zend_execute_internal ? zend_execute_internal : execute_internal;
+  zend_execute_internal = datadog_php_stack_collector_execute_internal;
+}
+
 /* The purpose of this hook is to be able to handle interrupts _before_ the
  * engine pops the internal call frame off the top of the stack. This has extra
  * performance cost.
@@ -383,8 +1833,31 @@ static void datadog_php_stack_collector_interrupt_function_helper(
 static void
 datadog_php_stack_collector_execute_internal(zend_execute_data *execute_data,
                                              zval *retval) {
+#if NATIVE_FRAMES_SUPPORTED
+  /* Native stacks are only walked up to this frame, as what's below it is the
+   * VM. The previous boundary is kept in this frame, so that a nested call
+   * restores it.
+   */
+  if (native_frames) {
+    uintptr_t outer_boundary = thread_globals.native_boundary;
+    thread_globals.native_boundary = (uintptr_t)__builtin_frame_address(0);
+    globals.prev_execute_internal(execute_data, retval);
+    thread_globals.native_boundary = outer_boundary;
+  } else {
+    globals.prev_execute_internal(execute_data, retval);
+  }
+#else
   globals.prev_execute_internal(execute_data, retval);
-  if (UNEXPECTED(EG(vm_interrupt))) {
+#endif
+  /* thread_globals lives in this shared object's dynamic TLS, so reading it
+   * can cost a __tls_get_addr call. EG(vm_interrupt) is set along with every
+   * tick, and on NTS builds it's a plain global, so only look at our own count
+   * when it's set. The count keeps interrupts which other extensions or the
+   * engine raised off the slow path.
+   */
+  if (UNEXPECTED(EG(vm_interrupt)) &&
+      atomic_load_explicit(&thread_globals.interrupt_count,
+                           memory_order_relaxed)) {
     /* This calls the version that doesn't delegate to the previous interrupt
      * function since interrupt handlers are not designed to run at this
      * location of the VM.
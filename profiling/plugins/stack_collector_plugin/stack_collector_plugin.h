@@ -3,12 +3,62 @@
 
 #include <Zend/zend_extensions.h>
 #include <profiling/config/config.h>
+#include <profiling/plugins/recorder_plugin/recorder_plugin.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 void datadog_php_stack_collector_startup(zend_extension *extension);
 void datadog_php_stack_collector_first_activate(
     datadog_php_profiling_config *config);
 void datadog_php_stack_collector_activate(void);
 void datadog_php_stack_collector_deactivate(void);
+void datadog_php_stack_collector_shutdown(zend_extension *extension);
+
+/**
+ * Other plugins which record their own wall and cpu time for the current
+ * thread, such as for garbage collection, call this so that the same time is
+ * not attributed again by the next stack sample. The ticks which came in
+ * meanwhile are taken from the next stack sample too, and their weighted count
+ * is returned for the caller's sample.
+ */
+uint64_t datadog_php_stack_collector_exclude_time(int64_t wall_time,
+                                                  int64_t cpu_time);
+
+/**
+ * Returns whether the current request is profiled. Only the configured share
+ * of workers and requests are, and other plugins which record samples skip the
+ * rest too, so that all sample types cover the same requests.
+ */
+bool datadog_php_stack_collector_request_sampled(void);
+
+/**
+ * Scales up the measured `values` of a sample from the current request by the
+ * inverse of the sample rate, so totals stay unbiased. Counts which came from
+ * datadog_php_stack_collector_exclude_time are already weighted.
+ */
+void datadog_php_stack_collector_weight(datadog_php_record_values *values);
+
+/**
+ * Returns the cpu time in nanoseconds which the current thread spent in the
+ * span `span_id`, excluding its child spans, and forgets it. Returns 0 if the
+ * span isn't known or cpu time profiling is disabled. It's accurate to within
+ * a sampling interval at each span boundary.
+ */
+int64_t datadog_php_stack_collector_take_span_cpu_time(uint64_t span_id);
+
+/**
+ * Starts a profiling region on the current thread, which is sampled every
+ * `interval_ms` if that's sooner than usual, or at the usual interval if it's
+ * 0. Regions nest, and the outermost one's interval applies. When only regions
+ * are profiled, the thread is sampled only while it's in one. Returns false if
+ * the request isn't being profiled.
+ */
+bool datadog_php_stack_collector_start_region(uint32_t interval_ms);
+
+/**
+ * Ends the innermost profiling region on the current thread. Returns false if
+ * the thread isn't in one or the request isn't being profiled.
+ */
+bool datadog_php_stack_collector_end_region(void);
 
 #endif // DATADOG_PHP_STACK_COLLECTOR_PLUGIN_H
@@ -0,0 +1,258 @@
+#include "stack-collector.h"
+
+#include <Zend/zend_compile.h>
+#include <Zend/zend_portability.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef datadog_php_string_view string_view_t;
+
+#if defined(__linux__)
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* Another thread may free or reuse the memory which is being walked at any
+ * moment, so every read goes through process_vm_readv on our own pid. It
+ * fails with EFAULT for unmapped memory instead of crashing, and it's allowed
+ * even without ptrace permissions because the target is the calling process.
+ */
+static pid_t self_pid;
+
+static bool remote_read(void *dst, const void *src, size_t len) {
+  struct iovec local = {.iov_base = dst, .iov_len = len};
+  struct iovec remote = {.iov_base = (void *)src, .iov_len = len};
+  return process_vm_readv(self_pid, &local, 1, &remote, 1, 0) == (ssize_t)len;
+}
+
+bool datadog_php_stack_collect_remote_available(void) {
+  self_pid = getpid();
+  uint64_t src = UINT64_C(0x5ca1ab1e), dst = 0;
+  return remote_read(&dst, &src, sizeof dst) && dst == src;
+}
+
+/**
+ * Reads up to `capacity` bytes of the zend_string `str` into `buffer`. Returns
+ * an empty view if `str` is NULL or cannot be read.
+ */
+static string_view_t remote_read_zstr(char *buffer, size_t capacity,
+                                      const zend_string *str) {
+  size_t len;
+  if (!str || !remote_read(&len, &str->len, sizeof len)) {
+    return (string_view_t){0, ""};
+  }
+
+  len = len < capacity ? len : capacity;
+  if (!remote_read(buffer, str->val, len)) {
+    return (string_view_t){0, ""};
+  }
+  return (string_view_t){len, buffer};
+}
+
+/**
+ * Reads the NUL-terminated `str` into `buffer`, truncating it at `capacity`.
+ * The string may end just before an unmapped page, so the read is split at
+ * the page boundary and the second part is allowed to fail.
+ */
+static string_view_t remote_read_cstr(char *buffer, size_t capacity,
+                                      const char *str) {
+  if (!str) {
+    return (string_view_t){0, ""};
+  }
+
+  uintptr_t page_size = (uintptr_t)sysconf(_SC_PAGESIZE);
+  uintptr_t page_end = ((uintptr_t)str / page_size + 1) * page_size;
+  size_t first = page_end - (uintptr_t)str;
+  first = first < capacity ? first : capacity;
+
+  struct iovec local = {.iov_base = buffer, .iov_len = capacity};
+  struct iovec remote[2] = {
+      {.iov_base = (void *)str, .iov_len = first},
+      {.iov_base = (void *)page_end, .iov_len = capacity - first},
+  };
+  unsigned long n_remote = capacity - first ? 2 : 1;
+  ssize_t result = process_vm_readv(self_pid, &local, 1, remote, n_remote, 0);
+  if (result <= 0) {
+    return (string_view_t){0, ""};
+  }
+
+  const char *nul = memchr(buffer, '\0', (size_t)result);
+  return (string_view_t){nul ? (size_t)(nul - buffer) : (size_t)result, buffer};
+}
+
+typedef enum {
+  REMOTE_FRAME_SKIPPED,
+  REMOTE_FRAME_ADDED,
+  REMOTE_FRAME_FULL,  // the sample is full; keep what was collected so far
+  REMOTE_FRAME_FAULT, // memory couldn't be read; discard the walk
+} remote_frame_result;
+
+/* Formats and adds the frame of `execute_data`, which is a local copy of the
+ * remote frame, following the same rules as the local collector.
+ */
+static remote_frame_result
+remote_collect_frame(const zend_execute_data *execute_data,
+                     datadog_php_stack_sample *sample) {
+  zend_function *func = execute_data->func;
+  if (!func) {
+    return REMOTE_FRAME_SKIPPED; // dummy frame
+  }
+
+  // Only read the members which are needed, as the zend_function union is
+  // bigger than an internal function's allocation.
+  zend_uchar type;
+  zend_class_entry *scope;
+  zend_string *function_name;
+  if (!remote_read(&type, &func->common.type, sizeof type) ||
+      !remote_read(&scope, &func->common.scope, sizeof scope) ||
+      !remote_read(&function_name, &func->common.function_name,
+                   sizeof function_name)) {
+    return REMOTE_FRAME_FAULT;
+  }
+
+  char module_buf[64], class_buf[128], func_buf[128], file_buf[1024];
+  string_view_t module = {0, ""};
+  string_view_t file = {0, ""};
+  int64_t lineno = 0;
+
+  if (type == ZEND_INTERNAL_FUNCTION) {
+    zend_module_entry *entry;
+    const char *name = NULL;
+    if (remote_read(&entry, &func->internal_function.module, sizeof entry) &&
+        entry) {
+      (void)remote_read(&name, &entry->name, sizeof name);
+    }
+    module = remote_read_cstr(module_buf, sizeof module_buf, name);
+  } else if (type == ZEND_USER_FUNCTION) {
+    zend_string *filename;
+    if (remote_read(&filename, &func->op_array.filename, sizeof filename)) {
+      file = remote_read_zstr(file_buf, sizeof file_buf, filename);
+    }
+    uint32_t line;
+    if (execute_data->opline &&
+        remote_read(&line, &execute_data->opline->lineno, sizeof line)) {
+      lineno = line;
+    }
+  }
+
+  zend_string *class_name = NULL;
+  if (scope) {
+    (void)remote_read(&class_name, &scope->name, sizeof class_name);
+  }
+  string_view_t Class =
+      remote_read_zstr(class_buf, sizeof class_buf, class_name);
+  string_view_t Func =
+      remote_read_zstr(func_buf, sizeof func_buf, function_name);
+
+  char buffer[256u];
+  int result = snprintf(buffer, sizeof buffer, "%.*s%s%.*s%s%.*s",
+                        (int)module.len, module.ptr, module.len ? "|" : "",
+                        (int)Class.len, Class.ptr, Class.len ? "::" : "",
+                        (int)Func.len, Func.ptr);
+  if (UNEXPECTED(result < 0 || ((size_t)result) >= sizeof buffer)) {
+    return REMOTE_FRAME_SKIPPED;
+  }
+
+  datadog_php_stack_sample_frame frame = {
+      .function = {(size_t)result, buffer},
+      .file = file,
+      .lineno = lineno,
+  };
+  if (!frame.function.len && !frame.file.len) {
+    return REMOTE_FRAME_SKIPPED;
+  }
+  if (frame.file.len && !frame.function.len) {
+    frame.function = (string_view_t){sizeof("<php>") - 1, "<php>"};
+  }
+
+  return datadog_php_stack_sample_try_add(sample, frame) ? REMOTE_FRAME_ADDED
+                                                          : REMOTE_FRAME_FULL;
+}
+
+/* The frames which were walked, so they can be checked again afterwards. Dummy
+ * frames don't count towards the sample's depth, so there's room for some.
+ */
+#define REMOTE_WALK_CAPACITY (2u * DATADOG_PHP_STACK_SAMPLE_MAX_DEPTH)
+
+typedef struct {
+  zend_execute_data *at;
+  zend_function *func;
+  const zend_op *opline;
+  zend_execute_data *prev;
+} remote_frame_link;
+
+bool datadog_php_stack_collect_remote(
+    zend_execute_data *const *current_execute_data,
+    datadog_php_stack_sample *sample) {
+  datadog_php_stack_sample_ctor(sample);
+
+  zend_execute_data *top;
+  if (!remote_read(&top, current_execute_data, sizeof top)) {
+    return false;
+  }
+
+  remote_frame_link links[REMOTE_WALK_CAPACITY];
+  uint32_t n_links = 0;
+  zend_execute_data *execute_data = top;
+  for (uint16_t depth = 0; depth < datadog_php_stack_sample_max_depth &&
+                           n_links != REMOTE_WALK_CAPACITY && execute_data;) {
+    zend_execute_data copy;
+    if (!remote_read(&copy, execute_data, sizeof copy)) {
+      return false;
+    }
+    links[n_links++] = (remote_frame_link){
+        .at = execute_data,
+        .func = copy.func,
+        .opline = copy.opline,
+        .prev = copy.prev_execute_data,
+    };
+
+    remote_frame_result result = remote_collect_frame(&copy, sample);
+    if (result == REMOTE_FRAME_FAULT) {
+      return false;
+    } else if (result == REMOTE_FRAME_FULL) {
+      break;
+    } else if (result == REMOTE_FRAME_ADDED) {
+      ++depth;
+    }
+    execute_data = copy.prev_execute_data;
+  }
+
+  /* The walk is only valid if the thread didn't return from or replace any of
+   * the frames while they were being read, so read every frame's links again.
+   * If a frame was popped and the same function was called again from the
+   * same caller into the same memory, then the walk still describes the stack
+   * as it is. The VM only saves the opline into a frame at some points, so
+   * comparing them only catches some line changes, but it's free to check.
+   */
+  zend_execute_data *top_after;
+  if (!remote_read(&top_after, current_execute_data, sizeof top_after) ||
+      top_after != top) {
+    return false;
+  }
+  for (uint32_t i = 0; i != n_links; ++i) {
+    zend_execute_data copy;
+    if (!remote_read(&copy, links[i].at, sizeof copy) ||
+        copy.func != links[i].func || copy.opline != links[i].opline ||
+        copy.prev_execute_data != links[i].prev) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+#else
+
+bool datadog_php_stack_collect_remote_available(void) { return false; }
+
+bool datadog_php_stack_collect_remote(
+    zend_execute_data *const *current_execute_data,
+    datadog_php_stack_sample *sample) {
+  (void)current_execute_data;
+  datadog_php_stack_sample_ctor(sample);
+  return false;
+}
+
+#endif
@@ -5,12 +5,13 @@
 
 typedef datadog_php_string_view string_view_t;
 
-void datadog_php_stack_collect(zend_execute_data *execute_data,
-                               datadog_php_stack_sample *sample) {
-  datadog_php_stack_sample_ctor(sample);
-
-  for (uint16_t depth = 0;
-       depth < datadog_php_stack_sample_max_depth && execute_data;
+// Adds the frames from `execute_data` until `stop` to the frames in `sample`.
+static void stack_collect_frames(zend_execute_data *execute_data,
+                                 zend_execute_data *stop,
+                                 datadog_php_stack_sample *sample) {
+  for (uint16_t depth = sample->depth;
+       depth < datadog_php_stack_sample_max_depth && execute_data &&
+       execute_data != stop;
        execute_data = execute_data->prev_execute_data) {
     zend_function *func = execute_data->func;
 
@@ -99,3 +100,33 @@ void datadog_php_stack_collect(zend_execute_data *execute_data,
     }
   }
 }
+
+void datadog_php_stack_collect(zend_execute_data *execute_data,
+                               datadog_php_stack_sample *sample) {
+  datadog_php_stack_sample_ctor(sample);
+  stack_collect_frames(execute_data, NULL, sample);
+}
+
+void datadog_php_stack_collect_until(zend_execute_data *execute_data,
+                                     zend_execute_data *bottom,
+                                     datadog_php_stack_sample *sample) {
+  datadog_php_stack_sample_ctor(sample);
+  stack_collect_frames(execute_data, bottom ? bottom->prev_execute_data : NULL,
+                       sample);
+}
+
+void datadog_php_stack_collect_synthetic(datadog_php_stack_sample_frame frame,
+                                         zend_execute_data *execute_data,
+                                         datadog_php_stack_sample *sample) {
+  datadog_php_stack_sample_ctor(sample);
+  if (datadog_php_stack_sample_try_add(sample, frame)) {
+    stack_collect_frames(execute_data, NULL, sample);
+  }
+}
+
+void datadog_php_stack_collect_onto_until(zend_execute_data *execute_data,
+                                          zend_execute_data *bottom,
+                                          datadog_php_stack_sample *sample) {
+  stack_collect_frames(execute_data, bottom ? bottom->prev_execute_data : NULL,
+                       sample);
+}
@@ -2,9 +2,55 @@
 #define DATADOG_PHP_STACK_COLLECTOR_H
 
 #include <components/stack-sample/stack-sample.h>
+#include <stdbool.h>
 
 typedef struct _zend_execute_data zend_execute_data;
 
 void datadog_php_stack_collect(zend_execute_data *, datadog_php_stack_sample *);
 
+/**
+ * Collects the stack like datadog_php_stack_collect, but stops after the
+ * `bottom` frame, such as the bottom of a fiber's stack. If `bottom` is NULL
+ * then the whole stack is collected.
+ */
+void datadog_php_stack_collect_until(zend_execute_data *,
+                                     zend_execute_data *bottom,
+                                     datadog_php_stack_sample *);
+
+/**
+ * Collects the stack like datadog_php_stack_collect, but first pushes the
+ * synthetic `frame` as the leaf. This is used to attribute work the engine
+ * does on behalf of the current stack, such as garbage collection.
+ */
+void datadog_php_stack_collect_synthetic(datadog_php_stack_sample_frame frame,
+                                         zend_execute_data *,
+                                         datadog_php_stack_sample *);
+
+/**
+ * Collects the stack like datadog_php_stack_collect_until, but keeps the frames
+ * which are already in the sample as the leaves, such as the native frames of
+ * the code which the top internal function was running.
+ */
+void datadog_php_stack_collect_onto_until(zend_execute_data *,
+                                          zend_execute_data *bottom,
+                                          datadog_php_stack_sample *);
+
+/**
+ * Returns whether datadog_php_stack_collect_remote can work on this platform
+ * and in this process. Call it once before collecting any remote stacks.
+ */
+bool datadog_php_stack_collect_remote_available(void);
+
+/**
+ * Collects the stack of another thread, given the address of its
+ * EG(current_execute_data), without any cooperation from that thread. All of
+ * its memory is read defensively, and every frame which was walked is read
+ * again afterwards. Returns false if the memory couldn't be read or the thread
+ * changed any of those frames during the walk, in which case the sample must be
+ * discarded.
+ */
+bool datadog_php_stack_collect_remote(
+    zend_execute_data *const *current_execute_data,
+    datadog_php_stack_sample *sample);
+
 #endif // DATADOG_PHP_STACK_COLLECTOR_H
@@ -0,0 +1,38 @@
+--TEST--
+[profiling] test datadog_profiling_burst when the profiler is disabled
+--DESCRIPTION--
+An incident runbook may call datadog_profiling_burst on workers where the
+profiler is off, so it's registered anyway. $seconds must be from 1 to 3600
+and $interval_ms from 1 to 1000, with a warning otherwise. Valid bursts
+return false, as there is nothing to sample.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=no
+--FILE--
+<?php
+
+var_dump(function_exists('datadog_profiling_burst'));
+var_dump(datadog_profiling_burst(0));
+var_dump(datadog_profiling_burst(60, 0));
+var_dump(datadog_profiling_burst(60, 1001));
+var_dump(datadog_profiling_burst(60));
+var_dump(datadog_profiling_burst(60, 5));
+
+?>
+--EXPECTF--
+bool(true)
+
+Warning: datadog_profiling_burst(): $seconds must be between 1 and 3600 in %s on line %d
+bool(false)
+
+Warning: datadog_profiling_burst(): $interval_ms must be between 1 and 1000 in %s on line %d
+bool(false)
+
+Warning: datadog_profiling_burst(): $interval_ms must be between 1 and 1000 in %s on line %d
+bool(false)
+bool(false)
+bool(false)
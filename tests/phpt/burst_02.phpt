@@ -0,0 +1,30 @@
+--TEST--
+[profiling] test datadog_profiling_burst when the profiler is enabled
+--DESCRIPTION--
+With the profiler enabled, a burst is accepted and returns true, whether it's
+the first one or it replaces one that is still in progress. The agent can't be
+reached here, so the burst profile is dropped after the test, which isn't
+visible from PHP.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=yes
+DD_TRACE_AGENT_URL=http://localhost:1
+--FILE--
+<?php
+
+var_dump(datadog_profiling_burst(1));
+var_dump(datadog_profiling_burst(2, 5));
+
+$deadline = microtime(true) + 0.05;
+while (microtime(true) < $deadline) {
+    hash('sha256', str_repeat('x', 1024));
+}
+
+?>
+--EXPECT--
+bool(true)
+bool(true)
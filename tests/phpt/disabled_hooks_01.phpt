@@ -4,8 +4,13 @@
 The profiler installs some hooks even when disabled, because it cannot
 generally know if it's disabled until the first request comes in. The profiler
 always installs these hooks:
-- `zend_execute_internal`
 - `zend_interrupt_function`
+- `zend_throw_exception_hook`
+- `gc_collect_cycles`
+- `zend_compile_file` and `zend_compile_string`
+
+It only installs `zend_execute_internal` during the first request, and only if
+profiling is enabled, so it isn't installed here.
 
 The purpose of this test is to ensure that when the profiler is disabled that
 regular behaviors which might use these hooks are unaffected. Note that the
@@ -0,0 +1,38 @@
+--TEST--
+[profiling] test custom labels when the profiler is disabled
+--DESCRIPTION--
+Applications set labels like a tenant id on every request, whether or not the
+profiler is on. Keys must be 1 to 255 bytes and values at most 255, with a
+warning otherwise. Valid labels are neither set nor cleared, as there is no
+profile for them to go into, so every call returns false.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=no
+--FILE--
+<?php
+
+var_dump(function_exists('datadog_profiling_set_label'));
+var_dump(function_exists('datadog_profiling_clear_label'));
+var_dump(datadog_profiling_set_label('', 'acme'));
+var_dump(datadog_profiling_set_label('tenant', str_repeat('x', 256)));
+var_dump(datadog_profiling_set_label('tenant', 'acme'));
+var_dump(datadog_profiling_clear_label('tenant'));
+var_dump(datadog_profiling_clear_label());
+
+?>
+--EXPECTF--
+bool(true)
+bool(true)
+
+Warning: datadog_profiling_set_label(): $key must be between 1 and 255 bytes long in %s on line %d
+bool(false)
+
+Warning: datadog_profiling_set_label(): $value must be at most 255 bytes long in %s on line %d
+bool(false)
+bool(false)
+bool(false)
+bool(false)
@@ -0,0 +1,85 @@
+--TEST--
+[profiling] test that custom labels end up in the uploaded profile
+--DESCRIPTION--
+Runs a child PHP process with the profiler enabled, which sets a custom label
+and then burns some cpu. The test stands in for the agent. At shutdown, the
+child uploads its profile to the test, and the label's key and value must be
+in the profile's string table. The child loads the same profiler as this
+process, which is found through /proc/self/maps.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+if (!is_readable('/proc/self/maps'))
+  echo "skip: test requires /proc/self/maps\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=no
+--FILE--
+<?php
+
+$extension = null;
+foreach (file('/proc/self/maps') as $line) {
+    if (preg_match('~(/\S*datadog-profiling\S*\.so)$~', trim($line), $m)) {
+        $extension = $m[1];
+        break;
+    }
+}
+var_dump($extension !== null);
+
+$server = stream_socket_server('tcp://127.0.0.1:0', $errno, $errstr);
+$port = parse_url('tcp://' . stream_socket_get_name($server, false),
+                  PHP_URL_PORT);
+
+$code = <<<'PHP'
+var_dump(datadog_profiling_set_label('tenant', 'acme-corp-7'));
+$deadline = microtime(true) + 0.2;
+$x = 0;
+while (microtime(true) < $deadline) {
+    for ($i = 0; $i < 1000; ++$i) {
+        $x += $i;
+    }
+}
+PHP;
+
+$command = [PHP_BINARY, '-n', '-d', "zend_extension=$extension", '-r', $code];
+$env = [
+    'DD_PROFILING_ENABLED' => 'yes',
+    'DD_TRACE_AGENT_URL' => "http://127.0.0.1:$port",
+];
+$child = proc_open($command, [1 => ['pipe', 'w']], $pipes, null, $env);
+
+$request = '';
+$connection = stream_socket_accept($server, 30);
+if ($connection) {
+    stream_set_timeout($connection, 5);
+    while (!feof($connection) && strpos($request, "\r\n\r\n") === false) {
+        $request .= fread($connection, 8192);
+    }
+    $length = preg_match('/^content-length:\s*(\d+)/mi', $request, $m)
+        ? (int)$m[1] : 0;
+    $body_at = strpos($request, "\r\n\r\n") + 4;
+    while (!feof($connection) && strlen($request) - $body_at < $length) {
+        $chunk = fread($connection, 8192);
+        if ($chunk === '' || $chunk === false) {
+            break;
+        }
+        $request .= $chunk;
+    }
+    fwrite($connection, "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n");
+    fclose($connection);
+}
+
+echo stream_get_contents($pipes[1]);
+fclose($pipes[1]);
+proc_close($child);
+
+var_dump(strpos($request, 'tenant') !== false);
+var_dump(strpos($request, 'acme-corp-7') !== false);
+
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
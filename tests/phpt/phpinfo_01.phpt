@@ -44,6 +44,7 @@ assert(isset($values["Version"]));
 // Check exact values for this set
 $sections = [
     ["Profiling Enabled", "false"],
+    ["Diagnostics Upload Enabled", "false"],
     ["Experimental CPU Profiling Enabled", "true"],
     ["Profiling Log Level", "info"],
     ["Profiling Agent Endpoint", "http://datadog:8126"],
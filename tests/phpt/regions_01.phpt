@@ -0,0 +1,38 @@
+--TEST--
+[profiling] test profiling regions when the profiler is disabled
+--DESCRIPTION--
+Code wrapped in datadog_profiling_start_region and datadog_profiling_end_region
+must keep working where the profiler is off. $interval_ms must be from 0 to
+1000, with a warning otherwise. A valid region can't be started, as the
+request isn't being profiled, so there is no region to end either.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=no
+--FILE--
+<?php
+
+var_dump(function_exists('datadog_profiling_start_region'));
+var_dump(function_exists('datadog_profiling_end_region'));
+var_dump(datadog_profiling_start_region(-1));
+var_dump(datadog_profiling_start_region(1001));
+var_dump(datadog_profiling_start_region(5));
+var_dump(datadog_profiling_start_region());
+var_dump(datadog_profiling_end_region());
+
+?>
+--EXPECTF--
+bool(true)
+bool(true)
+
+Warning: datadog_profiling_start_region(): $interval_ms must be between 0 and 1000 in %s on line %d
+bool(false)
+
+Warning: datadog_profiling_start_region(): $interval_ms must be between 0 and 1000 in %s on line %d
+bool(false)
+bool(false)
+bool(false)
+bool(false)
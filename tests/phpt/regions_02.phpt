@@ -0,0 +1,73 @@
+--TEST--
+[profiling] test that a profiling region changes the sampling interval
+--DESCRIPTION--
+With only regions sampled, work outside of a region is never sampled. A region
+at the usual 10ms interval which is over within a couple of milliseconds isn't
+sampled either, while a region at 1ms is sampled several times over 30ms. The
+samples are read back through datadog_profiling_top, which the recorder thread
+fills in shortly after they're taken.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=yes
+DD_PROFILING_EXPERIMENTAL_REGIONS_ONLY=yes
+DD_PROFILING_EXPERIMENTAL_TOP_ENABLED=yes
+DD_TRACE_AGENT_URL=http://localhost:1
+--FILE--
+<?php
+
+function spin($ms) {
+    $deadline = microtime(true) + $ms / 1000;
+    $x = 0;
+    while (microtime(true) < $deadline) {
+        for ($i = 0; $i < 1000; ++$i) {
+            $x += $i;
+        }
+    }
+    return $x;
+}
+
+function outside_region() { return spin(30); }
+function usual_region() { return spin(2); }
+function fast_region() { return spin(30); }
+
+function sampled($function) {
+    foreach (datadog_profiling_top(64)['stacks'] as $entry) {
+        if (strpos($entry['stack'], $function) !== false) {
+            return true;
+        }
+    }
+    return false;
+}
+
+outside_region();
+
+var_dump(datadog_profiling_start_region());
+usual_region();
+var_dump(datadog_profiling_end_region());
+
+var_dump(datadog_profiling_start_region(1));
+fast_region();
+var_dump(datadog_profiling_end_region());
+
+$deadline = microtime(true) + 1;
+while (!sampled('fast_region') && microtime(true) < $deadline) {
+    usleep(10000);
+}
+
+var_dump(sampled('fast_region'));
+var_dump(sampled('usual_region'));
+var_dump(sampled('outside_region'));
+
+?>
+--EXPECT--
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(true)
+bool(false)
+bool(false)
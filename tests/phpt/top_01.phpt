@@ -0,0 +1,33 @@
+--TEST--
+[profiling] test datadog_profiling_top when the profiler is disabled
+--DESCRIPTION--
+datadog_profiling_top is registered even when the profiler is disabled, and
+enabling the top alone doesn't change that it has nothing to report. $n is
+still checked against the 64 entries which are tracked, with a warning when
+it's out of range, and then false is returned.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=no
+DD_PROFILING_EXPERIMENTAL_TOP_ENABLED=yes
+--FILE--
+<?php
+
+var_dump(function_exists('datadog_profiling_top'));
+var_dump(datadog_profiling_top(0));
+var_dump(datadog_profiling_top(65));
+var_dump(datadog_profiling_top());
+
+?>
+--EXPECTF--
+bool(true)
+
+Warning: datadog_profiling_top(): $n must be between 1 and 64 in %s on line %d
+bool(false)
+
+Warning: datadog_profiling_top(): $n must be between 1 and 64 in %s on line %d
+bool(false)
+bool(false)
@@ -0,0 +1,83 @@
+--TEST--
+[profiling] test that datadog_profiling_top returns entries after some work
+--DESCRIPTION--
+With the profiler and the top enabled, a function which burns cpu for a while
+shows up among the heaviest leaf functions, and in a folded stack under the
+function which called it. The recorder thread adds samples shortly after
+they're taken, so the test waits for them for up to a second. Each entry has
+its sample count and times.
+--SKIPIF--
+<?php
+if (!extension_loaded('datadog-profiling'))
+  echo "skip: test requires Datadog Continuous Profiler\n";
+?>
+--ENV--
+DD_PROFILING_ENABLED=yes
+DD_PROFILING_EXPERIMENTAL_TOP_ENABLED=yes
+DD_TRACE_AGENT_URL=http://localhost:1
+--FILE--
+<?php
+
+function burn_cpu() {
+    $deadline = microtime(true) + 0.2;
+    $x = 0;
+    while (microtime(true) < $deadline) {
+        for ($i = 0; $i < 1000; ++$i) {
+            $x += $i;
+        }
+    }
+    return $x;
+}
+
+function caller() { return burn_cpu(); }
+
+function find($entries, $key, $needle) {
+    foreach ($entries as $entry) {
+        if (strpos($entry[$key], $needle) !== false) {
+            return $entry;
+        }
+    }
+    return null;
+}
+
+caller();
+
+$deadline = microtime(true) + 1;
+while (true) {
+    $top = datadog_profiling_top(64);
+    $function = find($top['functions'], 'function', 'burn_cpu');
+    if ($function || microtime(true) >= $deadline) {
+        break;
+    }
+    usleep(10000);
+}
+
+$stack = find($top['stacks'], 'stack', 'caller;burn_cpu');
+
+var_dump(array_keys($top));
+var_dump($function !== null);
+var_dump($stack !== null);
+var_dump(array_keys($function));
+var_dump($function['samples'] > 0 && $function['wall_time_ns'] > 0);
+
+?>
+--EXPECT--
+array(2) {
+  [0]=>
+  string(9) "functions"
+  [1]=>
+  string(6) "stacks"
+}
+bool(true)
+bool(true)
+array(4) {
+  [0]=>
+  string(8) "function"
+  [1]=>
+  string(7) "samples"
+  [2]=>
+  string(12) "wall_time_ns"
+  [3]=>
+  string(11) "cpu_time_ns"
+}
+bool(true)